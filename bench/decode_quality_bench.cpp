@@ -0,0 +1,198 @@
+//解码质量档位对照：同一片段分别以FULL/FAST/PREVIEW/PROXY解码，报告解码fps及相对FULL的亮度PSNR/SSIM
+//g++ -O2 -std=c++17 -Iinclude bench/decode_quality_bench.cpp src/demuxer.cpp src/videoDecoder.cpp src/DecoderFramePool.cpp src/KeyframeIndex.cpp src/AVIOReader.cpp src/StreamInfoCache.cpp src/PacketPool.cpp $(pkg-config --cflags --libs libavformat libavcodec libswscale libavutil) -lpthread -o decode_quality_bench
+//./decode_quality_bench input.mp4 [max_frames=600] [compare_frames=60]
+//fps为解封装+解码的整体吞吐（各档位解封装开销相同），对比时低分辨率档位先双三次放大到FULL尺寸再算
+#include "demuxer.hpp"
+#include "videoDecoder.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+extern "C"{
+    #include <libswscale/swscale.h>
+}
+
+struct Tier{
+    const char* name;
+    DecodeQuality quality;
+};
+
+struct Result{
+    int frames = 0;
+    double seconds = 0;
+    int width = 0;
+    int height = 0;
+    int lowres = 0;
+};
+
+//一帧的亮度平面，已换算到参考尺寸
+using LumaPlane = std::vector<uint8_t>;
+
+//解码前max_frames帧；luma非空时把前compare_frames帧的亮度缩放到ref_w x ref_h保存
+static bool decodeClip(const char* path,DecodeQuality quality,int max_frames,
+                       int compare_frames,int ref_w,int ref_h,
+                       std::vector<LumaPlane>* luma,Result& result){
+    Demuxer demuxer;
+    if(!demuxer.loadfile(path) || !demuxer.open_video_format()){
+        fprintf(stderr,"could not open video stream in %s\n",path);
+        return false;
+    }
+    int video_idx = demuxer.getVideoStreamIndex();
+    videoDecoder decoder;
+    //lowres只能在打开前设置
+    decoder.setDecodeQuality(quality);
+    if(!decoder.initialize_fromstream(demuxer.get_videostream()->codecpar)){
+        return false;
+    }
+    result = Result();
+    result.lowres = decoder.getLowres();
+
+    SwsContext* sws = nullptr;
+    auto on_frame = [&](AVFrame* frame) -> bool {
+        if(result.frames >= max_frames){
+            return false;
+        }
+        result.frames++;
+        result.width = frame->width;
+        result.height = frame->height;
+        if(luma && (int)luma->size() < compare_frames){
+            sws = sws_getCachedContext(sws,frame->width,frame->height,(AVPixelFormat)frame->format,
+                                       ref_w,ref_h,AV_PIX_FMT_GRAY8,SWS_BICUBIC,nullptr,nullptr,nullptr);
+            if(sws){
+                luma->emplace_back((size_t)ref_w * ref_h);
+                uint8_t* dst[4] = {luma->back().data(),nullptr,nullptr,nullptr};
+                int dst_linesize[4] = {ref_w,0,0,0};
+                sws_scale(sws,frame->data,frame->linesize,0,frame->height,dst,dst_linesize);
+            }
+        }
+        return true;
+    };
+
+    AVPacket* pkt = av_packet_alloc();
+    auto t0 = std::chrono::steady_clock::now();
+    while(result.frames < max_frames && demuxer.readPacket(pkt) >= 0){
+        if(pkt->stream_index == video_idx){
+            decoder.decode(pkt,on_frame);
+        }
+        av_packet_unref(pkt);
+    }
+    if(result.frames < max_frames){
+        decoder.drain(on_frame);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    av_packet_free(&pkt);
+    sws_freeContext(sws);
+    return result.frames > 0;
+}
+
+static double psnr(const LumaPlane& a,const LumaPlane& b){
+    double sse = 0;
+    for(size_t i = 0; i < a.size(); i++){
+        double d = (double)a[i] - b[i];
+        sse += d * d;
+    }
+    if(sse == 0){
+        return 100.0;
+    }
+    double mse = sse / a.size();
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+//8x8窗口、步长4的均值SSIM
+static double ssim(const LumaPlane& a,const LumaPlane& b,int w,int h){
+    const double c1 = (0.01 * 255) * (0.01 * 255);
+    const double c2 = (0.03 * 255) * (0.03 * 255);
+    double total = 0;
+    int windows = 0;
+    for(int y = 0; y + 8 <= h; y += 4){
+        for(int x = 0; x + 8 <= w; x += 4){
+            double sa = 0,sb = 0,saa = 0,sbb = 0,sab = 0;
+            for(int j = 0; j < 8; j++){
+                const uint8_t* pa = &a[(size_t)(y + j) * w + x];
+                const uint8_t* pb = &b[(size_t)(y + j) * w + x];
+                for(int i = 0; i < 8; i++){
+                    sa += pa[i];
+                    sb += pb[i];
+                    saa += pa[i] * pa[i];
+                    sbb += pb[i] * pb[i];
+                    sab += pa[i] * pb[i];
+                }
+            }
+            double ma = sa / 64,mb = sb / 64;
+            double va = saa / 64 - ma * ma;
+            double vb = sbb / 64 - mb * mb;
+            double cov = sab / 64 - ma * mb;
+            total += ((2 * ma * mb + c1) * (2 * cov + c2)) / ((ma * ma + mb * mb + c1) * (va + vb + c2));
+            windows++;
+        }
+    }
+    return windows ? total / windows : 1.0;
+}
+
+int main(int argc,char** argv){
+    if(argc < 2){
+        fprintf(stderr,"usage: %s input [max_frames=600] [compare_frames=60]\n",argv[0]);
+        return 1;
+    }
+    const char* path = argv[1];
+    int max_frames = argc > 2 ? atoi(argv[2]) : 600;
+    int compare_frames = argc > 3 ? atoi(argv[3]) : 60;
+
+    const Tier tiers[] = {
+        {"FULL",DecodeQuality::FULL},
+        {"FAST",DecodeQuality::FAST},
+        {"PREVIEW",DecodeQuality::PREVIEW},
+        {"PROXY",DecodeQuality::PROXY},
+    };
+
+    //先以FULL取参考尺寸和参考帧
+    Result full;
+    std::vector<LumaPlane> reference;
+    if(!decodeClip(path,DecodeQuality::FULL,compare_frames,compare_frames,0,0,nullptr,full)){
+        return 1;
+    }
+    int ref_w = full.width;
+    int ref_h = full.height;
+    if(!decodeClip(path,DecodeQuality::FULL,compare_frames,compare_frames,ref_w,ref_h,&reference,full)){
+        return 1;
+    }
+
+    printf("%s  reference %dx%d, %zu frames compared\n",path,ref_w,ref_h,reference.size());
+    printf("%-8s %6s %11s %7s %9s %8s %9s %7s\n","tier","lowres","size","frames","fps","speedup","psnr_y","ssim_y");
+    double full_fps = 0;
+    for(const Tier& tier : tiers){
+        //计时轮不做缩放和拷贝，只统计帧数
+        Result timed;
+        if(!decodeClip(path,tier.quality,max_frames,0,ref_w,ref_h,nullptr,timed)){
+            printf("%-8s failed\n",tier.name);
+            continue;
+        }
+        double fps = timed.frames / timed.seconds;
+        if(tier.quality == DecodeQuality::FULL){
+            full_fps = fps;
+        }
+
+        Result compared;
+        std::vector<LumaPlane> luma;
+        double sum_psnr = 0,sum_ssim = 0;
+        size_t n = 0;
+        if(decodeClip(path,tier.quality,compare_frames,compare_frames,ref_w,ref_h,&luma,compared)){
+            //各档位都不丢帧，按输出顺序一一对应
+            n = std::min(luma.size(),reference.size());
+            for(size_t i = 0; i < n; i++){
+                sum_psnr += psnr(reference[i],luma[i]);
+                sum_ssim += ssim(reference[i],luma[i],ref_w,ref_h);
+            }
+        }
+        char size[24];
+        snprintf(size,sizeof(size),"%dx%d",timed.width,timed.height);
+        printf("%-8s %6d %11s %7d %9.1f %7.2fx %9.2f %7.4f\n",tier.name,timed.lowres,size,timed.frames,fps,
+               full_fps > 0 ? fps / full_fps : 0.0,n ? sum_psnr / n : 0.0,n ? sum_ssim / n : 0.0);
+        if(n < reference.size()){
+            printf("         only %zu of %zu frames matched\n",n,reference.size());
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+//裸码流读取对照：旧的fread小块路径 vs RawStreamReader的mmap窗口路径，分别测纯读取和读取+av_parser_parse2
+//g++ -O2 -std=c++17 -Iinclude bench/raw_read_bench.cpp src/RawStreamReader.cpp $(pkg-config --cflags --libs libavcodec libavutil) -o raw_read_bench
+//./raw_read_bench input.h264 [decoder=h264] [window_mb=16] [fread_chunk=4096] [cold=1]
+//cold=1时每轮前用POSIX_FADV_DONTNEED丢弃页缓存，测冷读；否则为热缓存
+#include "RawStreamReader.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+struct Result{
+    double seconds = 0;
+    uint64_t bytes = 0;
+    uint64_t packets = 0;
+    uint64_t calls = 0;     // read/next调用次数
+};
+
+static void dropCache(const char* path){
+    int fd = open(path,O_RDONLY);
+    if(fd >= 0){
+        posix_fadvise(fd,0,0,POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+//解析器由调用方创建；parser为空时只读取并逐页触碰数据
+class Parser{
+public:
+    Parser(AVCodecID id){
+        if(id != AV_CODEC_ID_NONE){
+            parser_ = av_parser_init(id);
+            ctx_ = avcodec_alloc_context3(avcodec_find_decoder(id));
+        }
+    }
+    ~Parser(){
+        if(parser_) av_parser_close(parser_);
+        avcodec_free_context(&ctx_);
+    }
+    uint64_t feed(const uint8_t* data,size_t size){
+        if(!parser_){
+            //没有解析器时按页读一个字节，保证映射页真正被访问
+            uint64_t sum = 0;
+            for(size_t i = 0; i < size; i += 4096){
+                sum += data[i];
+            }
+            sink_ += sum;
+            return 0;
+        }
+        uint64_t packets = 0;
+        do{
+            uint8_t* out = nullptr;
+            int out_size = 0;
+            int used = av_parser_parse2(parser_,ctx_,&out,&out_size,data,(int)size,
+                                        AV_NOPTS_VALUE,AV_NOPTS_VALUE,0);
+            if(used < 0){
+                return packets;
+            }
+            data += used;
+            size -= used;
+            if(out_size > 0){
+                packets++;
+            }
+        }while(size > 0);
+        return packets;
+    }
+    //与feedRawStream相同，空输入反复冲刷直到解析器不再吐包
+    uint64_t flush(){
+        uint64_t total = 0;
+        while(parser_){
+            uint64_t n = feed(nullptr,0);
+            if(n == 0){
+                break;
+            }
+            total += n;
+        }
+        return total;
+    }
+    uint64_t sink_ = 0;
+private:
+    AVCodecParserContext* parser_ = nullptr;
+    AVCodecContext* ctx_ = nullptr;
+};
+
+static Result runFread(const char* path,AVCodecID id,size_t chunk){
+    Result r;
+    FILE* f = fopen(path,"rb");
+    if(!f){
+        return r;
+    }
+    Parser parser(id);
+    std::vector<uint8_t> buffer(chunk + AV_INPUT_BUFFER_PADDING_SIZE,0);
+    auto t0 = std::chrono::steady_clock::now();
+    size_t n;
+    while((n = fread(buffer.data(),1,chunk,f)) > 0){
+        r.calls++;
+        r.bytes += n;
+        memset(buffer.data() + n,0,AV_INPUT_BUFFER_PADDING_SIZE);
+        r.packets += parser.feed(buffer.data(),n);
+    }
+    r.packets += parser.flush();
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    fclose(f);
+    return r;
+}
+
+static Result runWindow(const char* path,AVCodecID id,size_t window){
+    Result r;
+    RawStreamReader reader(window);
+    if(!reader.open(path)){
+        return r;
+    }
+    Parser parser(id);
+    auto t0 = std::chrono::steady_clock::now();
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    while(reader.next(data,size)){
+        r.calls++;
+        r.bytes += size;
+        r.packets += parser.feed(data,size);
+    }
+    if(reader.error()){
+        fprintf(stderr,"window read stopped early: %s\n",strerror(reader.error()));
+    }
+    r.packets += parser.flush();
+    r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    reader.close();
+    return r;
+}
+
+static void print(const char* name,const Result& r){
+    printf("%-24s %10.3f s %10.1f MB/s %10llu calls %10llu packets\n",name,r.seconds,
+           r.seconds > 0 ? r.bytes / r.seconds / (1024.0 * 1024.0) : 0.0,
+           (unsigned long long)r.calls,(unsigned long long)r.packets);
+}
+
+int main(int argc,char** argv){
+    if(argc < 2){
+        fprintf(stderr,"usage: %s input [decoder=h264] [window_mb=16] [fread_chunk=4096] [cold=1]\n",argv[0]);
+        return 1;
+    }
+    const char* path = argv[1];
+    const AVCodec* codec = avcodec_find_decoder_by_name(argc > 2 ? argv[2] : "h264");
+    if(!codec){
+        fprintf(stderr,"unknown decoder\n");
+        return 1;
+    }
+    size_t window = (size_t)(argc > 3 ? atoi(argv[3]) : 16) * 1024 * 1024;
+    size_t chunk = argc > 4 ? (size_t)atoi(argv[4]) : 4096;
+    bool cold = argc > 5 ? atoi(argv[5]) != 0 : true;
+
+    struct Mode{ const char* name; bool window; AVCodecID id; };
+    const Mode modes[] = {
+        {"fread read-only",false,AV_CODEC_ID_NONE},
+        {"mmap window read-only",true,AV_CODEC_ID_NONE},
+        {"fread + parser",false,codec->id},
+        {"mmap window + parser",true,codec->id},
+    };
+    printf("%s, window %zu MB, fread chunk %zu bytes, %s cache\n",path,window >> 20,chunk,cold ? "cold" : "warm");
+    for(const Mode& m : modes){
+        if(cold){
+            dropCache(path);
+        }
+        Result r = m.window ? runWindow(path,m.id,window) : runFread(path,m.id,chunk);
+        print(m.name,r);
+    }
+    return 0;
+}
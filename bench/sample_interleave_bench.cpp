@@ -0,0 +1,83 @@
+//SampleInterleave的SIMD与标量版本对照：先逐字节校验结果一致，再计时
+//g++ -O2 -std=c++17 -Iinclude bench/sample_interleave_bench.cpp src/SampleInterleave.cpp -o sample_interleave_bench
+//./sample_interleave_bench [nb_samples] [iterations]
+#include "SampleInterleave.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+typedef void (*InterleaveFn)(uint8_t*,const uint8_t* const*,int,int,int);
+typedef void (*DeinterleaveFn)(uint8_t* const*,const uint8_t*,int,int,int);
+
+static double timeInterleave(InterleaveFn fn,uint8_t* dst,const uint8_t* const* src,
+                             int channels,int n,int bps,int iterations){
+    auto t0 = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++){
+        fn(dst,src,channels,n,bps);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static double timeDeinterleave(DeinterleaveFn fn,uint8_t* const* dst,const uint8_t* src,
+                               int channels,int n,int bps,int iterations){
+    auto t0 = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations; i++){
+        fn(dst,src,channels,n,bps);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc,char** argv){
+    //默认一帧1024样本再加3个，覆盖SIMD块之后的尾部
+    int n = argc > 1 ? atoi(argv[1]) : 1027;
+    int iterations = argc > 2 ? atoi(argv[2]) : 20000;
+    printf("kernel: %s, %d samples x %d iterations\n",SampleInterleave::kernelName(),n,iterations);
+    printf("%-4s %-4s %14s %14s %8s %14s %14s %8s\n",
+           "ch","bits","interleave ns","scalar ns","speedup","deinterl. ns","scalar ns","speedup");
+
+    bool all_ok = true;
+    for(int bps = 2; bps <= 4; bps += 2){
+        for(int channels = 1; channels <= 8; channels++){
+            size_t plane = (size_t)n * bps;
+            std::vector<std::vector<uint8_t>> planes(channels,std::vector<uint8_t>(plane));
+            std::vector<std::vector<uint8_t>> out_planes(channels,std::vector<uint8_t>(plane));
+            std::vector<std::vector<uint8_t>> ref_planes(channels,std::vector<uint8_t>(plane));
+            std::vector<const uint8_t*> src(channels);
+            std::vector<uint8_t*> out(channels),ref(channels);
+            for(int c = 0; c < channels; c++){
+                for(size_t i = 0; i < plane; i++){
+                    planes[c][i] = (uint8_t)rand();
+                }
+                src[c] = planes[c].data();
+                out[c] = out_planes[c].data();
+                ref[c] = ref_planes[c].data();
+            }
+            std::vector<uint8_t> packed(plane * channels),packed_ref(plane * channels);
+
+            SampleInterleave::interleave(packed.data(),src.data(),channels,n,bps);
+            SampleInterleave::interleaveScalar(packed_ref.data(),src.data(),channels,n,bps);
+            SampleInterleave::deinterleave(out.data(),packed.data(),channels,n,bps);
+            SampleInterleave::deinterleaveScalar(ref.data(),packed.data(),channels,n,bps);
+            bool ok = packed == packed_ref;
+            for(int c = 0; c < channels; c++){
+                ok = ok && out_planes[c] == planes[c] && ref_planes[c] == planes[c];
+            }
+            if(!ok){
+                printf("%-4d %-4d MISMATCH\n",channels,bps * 8);
+                all_ok = false;
+                continue;
+            }
+
+            double ti = timeInterleave(SampleInterleave::interleave,packed.data(),src.data(),channels,n,bps,iterations);
+            double tis = timeInterleave(SampleInterleave::interleaveScalar,packed.data(),src.data(),channels,n,bps,iterations);
+            double td = timeDeinterleave(SampleInterleave::deinterleave,out.data(),packed.data(),channels,n,bps,iterations);
+            double tds = timeDeinterleave(SampleInterleave::deinterleaveScalar,out.data(),packed.data(),channels,n,bps,iterations);
+            printf("%-4d %-4d %14.1f %14.1f %7.2fx %14.1f %14.1f %7.2fx\n",channels,bps * 8,
+                   ti * 1e9 / iterations,tis * 1e9 / iterations,tis / ti,
+                   td * 1e9 / iterations,tds * 1e9 / iterations,tds / td);
+        }
+    }
+    return all_ok ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+//MediaFormatConverter视频转换在不同分辨率、线程数下的吞吐，用于校准resolveVideoThreads的每线程行数
+//g++ -O2 -std=c++17 -Iinclude bench/sws_threads_bench.cpp src/FormatConverter.cpp src/ConverterCache.cpp $(pkg-config --cflags --libs libswscale libswresample libavcodec libavutil) -o sws_threads_bench
+//./sws_threads_bench [frames] [max_threads]
+#include "FormatConverter.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct Case{
+    const char* name;
+    int src_width, src_height;
+    AVPixelFormat src_format;
+    int dst_width, dst_height;
+    AVPixelFormat dst_format;
+};
+
+//返回每秒帧数，失败返回0
+static double run(const Case& c,int threads,int frames){
+    MediaFormatConverter converter;
+    converter.setVideoThreads(threads);
+    AVPixelFormat src_format = c.src_format;
+    AVPixelFormat dst_format = c.dst_format;
+    if(!converter.initVideoConverter(c.src_width,c.src_height,src_format,c.dst_width,c.dst_height,dst_format)){
+        return 0;
+    }
+    //源帧带引用计数缓冲，多线程时走sws_scale_frame
+    AVFrame* src = av_frame_alloc();
+    AVFrame* dst = av_frame_alloc();
+    src->width = c.src_width;
+    src->height = c.src_height;
+    src->format = c.src_format;
+    if(av_frame_get_buffer(src,0) < 0){
+        av_frame_free(&src);
+        av_frame_free(&dst);
+        return 0;
+    }
+    for(int p = 0; p < AV_NUM_DATA_POINTERS && src->buf[p]; p++){
+        for(size_t i = 0; i < src->buf[p]->size; i++){
+            src->buf[p]->data[i] = (uint8_t)(i * 7 + p);
+        }
+    }
+    //预热：建池、建线程
+    for(int i = 0; i < 3; i++){
+        converter.convertVideoInto(src,dst);
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    int done = 0;
+    for(; done < frames; done++){
+        if(!converter.convertVideoInto(src,dst)){
+            break;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    av_frame_free(&src);
+    av_frame_free(&dst);
+    return done == frames && seconds > 0 ? frames / seconds : 0;
+}
+
+int main(int argc,char** argv){
+    int frames = argc > 1 ? atoi(argv[1]) : 200;
+    int max_threads = argc > 2 ? atoi(argv[2]) : std::min(16,av_cpu_count());
+    const Case cases[] = {
+        {"720p  yuv420p->nv12",1280,720,AV_PIX_FMT_YUV420P,1280,720,AV_PIX_FMT_NV12},
+        {"1080p yuv420p->nv12",1920,1080,AV_PIX_FMT_YUV420P,1920,1080,AV_PIX_FMT_NV12},
+        {"4K    yuv420p->nv12",3840,2160,AV_PIX_FMT_YUV420P,3840,2160,AV_PIX_FMT_NV12},
+        {"1080p->720p yuv420p",1920,1080,AV_PIX_FMT_YUV420P,1280,720,AV_PIX_FMT_YUV420P},
+        {"4K->1080p   yuv420p",3840,2160,AV_PIX_FMT_YUV420P,1920,1080,AV_PIX_FMT_YUV420P},
+    };
+    printf("%d frames per run, %d cpus\n",frames,av_cpu_count());
+    for(const Case& c : cases){
+        printf("\n%s\n%-8s %10s %8s\n",c.name,"threads","fps","scaling");
+        double base = 0,best = 0;
+        int best_threads = 1;
+        for(int t = 1; t <= max_threads; t++){
+            double fps = run(c,t,frames);
+            if(t == 1){
+                base = fps;
+            }
+            //比最好结果快5%以上才算更优，避免为噪声多开线程
+            if(fps > best * 1.05){
+                best = fps;
+                best_threads = t;
+            }
+            printf("%-8d %10.1f %7.2fx\n",t,fps,base > 0 ? fps / base : 0.0);
+        }
+        MediaFormatConverter probe;
+        AVPixelFormat src_format = c.src_format;
+        AVPixelFormat dst_format = c.dst_format;
+        probe.initVideoConverter(c.src_width,c.src_height,src_format,c.dst_width,c.dst_height,dst_format);
+        int rows = std::max(c.src_height,c.dst_height);
+        printf("best %d threads (%d rows/thread), default picks %d\n",
+               best_threads,rows / best_threads,probe.getVideoThreads());
+        ConverterCache::instance().clear();
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+#ifndef AVIOREADER
+#define AVIOREADER
+
+#include <stdint.h>
+#include <string>
+#include <memory>
+extern "C"{
+    #include <libavformat/avformat.h>
+    #include <libavformat/avio.h>
+}
+
+enum class IOBackend { DEFAULT, MMAP, MEMORY, PIPE };
+
+//自定义AVIOContext的基类，子类只需实现read/seek
+class AVIOReader{
+public:
+    explicit AVIOReader(size_t buffer_size);
+    virtual ~AVIOReader();
+
+    virtual bool open() = 0;
+    AVIOContext* getContext();
+
+protected:
+    virtual int read(uint8_t* buf,int size) = 0;
+    virtual int64_t seek(int64_t offset,int whence) { return AVERROR(ENOSYS); }
+    virtual bool seekable() const { return false; }
+
+private:
+    static int readCallback(void* opaque,uint8_t* buf,int size);
+    static int64_t seekCallback(void* opaque,int64_t offset,int whence);
+
+    AVIOContext* avio_ctx_ = nullptr;
+    size_t buffer_size_;
+};
+
+//本地文件整体映射，顺序读取时由内核预读
+class MmapReader : public AVIOReader{
+public:
+    MmapReader(const std::string& path,size_t buffer_size = 1 << 20);
+    ~MmapReader();
+    bool open() override;
+
+protected:
+    int read(uint8_t* buf,int size) override;
+    int64_t seek(int64_t offset,int whence) override;
+    bool seekable() const override { return true; }
+
+private:
+    std::string path_;
+    int fd_ = -1;
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t pos_ = 0;
+};
+
+//调用方持有的内存数据，生命周期需覆盖解封装过程
+class MemoryReader : public AVIOReader{
+public:
+    MemoryReader(const uint8_t* data,size_t size,size_t buffer_size = 64 * 1024);
+    bool open() override { return data_ != nullptr; }
+
+protected:
+    int read(uint8_t* buf,int size) override;
+    int64_t seek(int64_t offset,int whence) override;
+    bool seekable() const override { return true; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+};
+
+//标准输入或已打开的管道，不可定位
+class PipeReader : public AVIOReader{
+public:
+    explicit PipeReader(int fd = 0,size_t buffer_size = 256 * 1024,bool owns_fd = false);
+    ~PipeReader();
+    bool open() override { return fd_ >= 0; }
+
+protected:
+    int read(uint8_t* buf,int size) override;
+
+private:
+    int fd_;
+    bool owns_fd_;
+};
+
+class AVIOReaderFactory{
+public:
+    //buffer_size为0时使用各后端默认值；路径"-"总是使用管道
+    static std::unique_ptr<AVIOReader> createReader(const std::string& path,IOBackend backend,size_t buffer_size = 0);
+};
+
+#endif
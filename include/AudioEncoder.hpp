@@ -15,6 +15,7 @@ extern "C"{
 }
 
 #include "BaseEncoder.hpp"
+#include "PacketPool.hpp"
 
 
 class AudioEncoder :public BaseEncoder{
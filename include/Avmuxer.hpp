@@ -31,6 +31,9 @@ class AVMuxer{
         int writePacket(AVPacket* pkt,AVRational timeBase);
         int addVideoStream(AVCodecParameters* codecpar);
         int addAudioStream(AVCodecParameters* codecpar);
+        //流拷贝：沿用输入流的编码参数和时间基，不经过编解码
+        int addStreamCopy(const AVStream* in_stream);
+        void setLogPackets(bool enable) { log_packets_ = enable; }
         int writeHeader();
         int getStreamIndex(AVMediaType type) const;
         void finalize();
@@ -49,7 +52,8 @@ class AVMuxer{
             int index;
         };
 
-        StreamPublisher* stream_publisher_;
+        StreamPublisher* stream_publisher_ = nullptr;
+        bool log_packets_ = true;
         std::vector<StreamInfo>stream_;
         std::mutex write_mutex_;
 
@@ -0,0 +1,76 @@
+#ifndef BATCHDECODESERVICE
+#define BATCHDECODESERVICE
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include "baseDecoder.hpp"
+#include "videoDecoder.hpp"
+#include "audioDecoder.hpp"
+
+struct BatchItem{
+    std::string input;
+    std::string output_dir;     // 为空时只解码不落盘
+};
+
+struct BatchFileStats{
+    std::string input;
+    bool ok = false;
+    int64_t video_frames = 0;
+    int64_t audio_frames = 0;
+    uint64_t bytes_in = 0;
+    double seconds = 0.0;
+    bool video_reused = false;  // 复用了上一个文件的解码上下文
+    bool audio_reused = false;
+    int worker = -1;
+
+    double framesPerSecond() const { return seconds > 0 ? (video_frames + audio_frames) / seconds : 0.0; }
+    double megabytesPerSecond() const { return seconds > 0 ? bytes_in / (1024.0 * 1024.0) / seconds : 0.0; }
+};
+
+struct BatchStats{
+    int files = 0;
+    int failed = 0;
+    int64_t frames = 0;
+    uint64_t bytes_in = 0;
+    int reused_contexts = 0;
+    double wall_seconds = 0.0;
+
+    double framesPerSecond() const { return wall_seconds > 0 ? frames / wall_seconds : 0.0; }
+    double megabytesPerSecond() const { return wall_seconds > 0 ? bytes_in / (1024.0 * 1024.0) / wall_seconds : 0.0; }
+};
+
+//批量解码：固定数量的worker各持一组解码器，依次从清单取文件
+class BatchDecodeService{
+public:
+    struct Config{
+        int workers = 0;                // 0为核数
+        bool decode_audio = true;
+        bool report = true;             // 每个文件完成时打印一行统计
+        DecoderThreadConfig thread_config;  // 自动模式下按worker数分摊核数
+        DecodeQuality quality = DecodeQuality::FULL;    // 仅作用于视频解码器
+    };
+
+    explicit BatchDecodeService(const Config& config);
+
+    //每行一个输入路径，可用制表符分隔输出目录；空行和#开头的行忽略
+    static bool loadManifest(const std::string& path,std::vector<BatchItem>& items,
+                             const std::string& default_output_dir = "");
+
+    BatchStats run(const std::vector<BatchItem>& items,std::vector<BatchFileStats>* per_file = nullptr);
+
+private:
+    struct Worker{
+        std::unique_ptr<videoDecoder> video;
+        std::unique_ptr<AudioDecoder> audio;
+    };
+
+    bool decodeOne(Worker& worker,const BatchItem& item,BatchFileStats& stats);
+    bool prepareDecoder(BaseDecoder* decoder,AVCodecParameters* codecpar,bool& reused);
+
+    Config config_;
+    DecoderThreadConfig worker_threads_;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef CONVERTERCACHE
+#define CONVERTERCACHE
+
+#include <stdint.h>
+#include <list>
+#include <mutex>
+#include <atomic>
+extern "C"{
+    #include <libswscale/swscale.h>
+    #include <libswscale/version.h>
+    #include <libswresample/swresample.h>
+    #include <libavutil/channel_layout.h>
+    #include <libavutil/samplefmt.h>
+}
+
+//swscale 6.1起支持threads选项，由sws_scale_frame按水平分片并行
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+#define SWS_HAS_THREADS 1
+#endif
+
+struct VideoConverterKey{
+    int src_width = 0;
+    int src_height = 0;
+    AVPixelFormat src_format = AV_PIX_FMT_NONE;
+    int dst_width = 0;
+    int dst_height = 0;
+    AVPixelFormat dst_format = AV_PIX_FMT_NONE;
+    int flags = SWS_BICUBIC;
+    int threads = 1;
+
+    bool operator==(const VideoConverterKey& o) const{
+        return src_width == o.src_width && src_height == o.src_height && src_format == o.src_format &&
+               dst_width == o.dst_width && dst_height == o.dst_height && dst_format == o.dst_format &&
+               flags == o.flags && threads == o.threads;
+    }
+    bool identity() const{
+        return src_width == dst_width && src_height == dst_height && src_format == dst_format;
+    }
+};
+
+//声道布局只按order/声道数/mask区分，自定义布局的上下文不进缓存
+struct AudioConverterKey{
+    AVSampleFormat src_format = AV_SAMPLE_FMT_NONE;
+    int src_sample_rate = 0;
+    AVChannelLayout src_layout = {};
+    AVSampleFormat dst_format = AV_SAMPLE_FMT_NONE;
+    int dst_sample_rate = 0;
+    AVChannelLayout dst_layout = {};
+
+    bool operator==(const AudioConverterKey& o) const{
+        return src_format == o.src_format && src_sample_rate == o.src_sample_rate &&
+               dst_format == o.dst_format && dst_sample_rate == o.dst_sample_rate &&
+               sameLayout(src_layout,o.src_layout) && sameLayout(dst_layout,o.dst_layout);
+    }
+    bool identity() const{
+        return src_format == dst_format && src_sample_rate == dst_sample_rate &&
+               av_channel_layout_compare(&src_layout,&dst_layout) == 0;
+    }
+    bool cacheable() const{
+        return src_layout.order != AV_CHANNEL_ORDER_CUSTOM && dst_layout.order != AV_CHANNEL_ORDER_CUSTOM;
+    }
+    static bool sameLayout(const AVChannelLayout& a,const AVChannelLayout& b){
+        if(a.order == AV_CHANNEL_ORDER_CUSTOM || b.order == AV_CHANNEL_ORDER_CUSTOM){
+            return av_channel_layout_compare(&a,&b) == 0;
+        }
+        return a.order == b.order && a.nb_channels == b.nb_channels &&
+               (a.order != AV_CHANNEL_ORDER_NATIVE || a.u.mask == b.u.mask);
+    }
+};
+
+//进程内共享的sws/swr上下文缓存，按转换参数取用
+//上下文本身不可并发使用：acquire独占，用完release放回；空闲的按最近使用保留，超出上限时释放最久未用的
+class ConverterCache{
+public:
+    struct Stats{
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t idle = 0;
+    };
+
+    static ConverterCache& instance();
+
+    SwsContext* acquireVideo(const VideoConverterKey& key);
+    void releaseVideo(const VideoConverterKey& key,SwsContext*& ctx);
+    SwrContext* acquireAudio(const AudioConverterKey& key);
+    //放回前重置重采样器，缓存中的上下文不带上一路流的延迟样本
+    void releaseAudio(const AudioConverterKey& key,SwrContext*& ctx);
+
+    void setMaxIdle(size_t max_idle);
+    Stats getStats() const;
+    void clear();
+
+private:
+    ConverterCache() = default;
+    ~ConverterCache();
+    ConverterCache(const ConverterCache&) = delete;
+    ConverterCache& operator=(const ConverterCache&) = delete;
+
+    static SwsContext* createVideo(const VideoConverterKey& key);
+    static SwrContext* createAudio(const AudioConverterKey& key);
+    void trimLocked();
+
+    struct VideoEntry{
+        VideoConverterKey key;
+        SwsContext* ctx;
+    };
+    struct AudioEntry{
+        AudioConverterKey key;
+        SwrContext* ctx;
+    };
+
+    mutable std::mutex mutex_;
+    std::list<VideoEntry> idle_video_;      // 表头为最近放回的
+    std::list<AudioEntry> idle_audio_;
+    size_t max_idle_ = 16;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+#endif
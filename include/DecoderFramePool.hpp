@@ -0,0 +1,51 @@
+#ifndef DECODERFRAMEPOOL
+#define DECODERFRAMEPOOL
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <mutex>
+extern "C"{
+    #include <libavcodec/avcodec.h>
+    #include <libavutil/buffer.h>
+}
+
+struct FramePoolConfig{
+    bool enabled = true;
+    size_t alignment = 64;          // 行宽与平面起始地址对齐，须为2的幂
+    bool use_hugepages = false;     // 先尝试MAP_HUGETLB，失败退回透明大页
+};
+
+//解码输出帧的get_buffer2分配器：按平面大小分级的AVBufferPool
+//帧的引用计数由AVBufferRef维护，池可在帧全部释放前析构
+class DecoderFramePool{
+public:
+    explicit DecoderFramePool(const FramePoolConfig& config);
+    ~DecoderFramePool();
+
+    //仅对支持DR1的视频解码器生效，返回是否已接管
+    bool attach(AVCodecContext* ctx);
+    static int getBuffer2(AVCodecContext* ctx,AVFrame* frame,int flags);
+
+    size_t getClassCount() const;
+
+private:
+    struct SizeClass{
+        size_t size;
+        bool hugepage;
+        AVBufferPool* pool;
+    };
+
+    AVBufferRef* acquire(size_t size);
+    size_t classSize(size_t size) const;
+
+    static AVBufferRef* allocBuffer(void* opaque,size_t size);
+    static void freeBuffer(void* opaque,uint8_t* data);
+    static void freeClass(void* opaque);
+
+    FramePoolConfig config_;
+    std::map<size_t,SizeClass*> classes_;
+    mutable std::mutex mutex_;      // 帧线程下get_buffer2会在解码线程中并发调用
+};
+
+#endif
@@ -8,6 +8,30 @@
 #include "FrameBuffer.hpp"
 #include "Avmuxer.hpp"
 
+//编码跟不上实时时的视频丢帧策略
+enum class DropPolicy{
+    NONE,
+    DROP_OLDEST,        // 丢掉最旧的帧直到积压回到阈值内
+    DROP_TO_LATEST,     // 直接跳到最新一帧，keyframe_on_drop时编成关键帧
+    DECIMATE,           // 过载期间按decimate_fps抽帧
+};
+
+struct FrameDropConfig{
+    DropPolicy policy = DropPolicy::NONE;
+    size_t max_queue_frames = 0;    // 积压帧数超过该值视为过载，0为不按深度判断
+    int max_latency_ms = 0;         // 待编码帧在缓冲中停留超过该时长视为过载，0为不按延迟判断
+    int decimate_fps = 0;           // DECIMATE的目标帧率，0为源帧率的一半
+    bool keyframe_on_drop = false;  // DROP_TO_LATEST跳帧后插入关键帧，便于播放端从跳变处重新同步
+};
+
+struct FrameDropStats{
+    uint64_t dropped_frames = 0;
+    uint64_t drop_events = 0;       // 触发丢帧的次数
+    uint64_t forced_keyframes = 0;
+    size_t max_queue_frames = 0;    // 观察到的最大积压
+    double max_latency_ms = 0.0;    // 观察到的最大排队延迟
+};
+
 class EncodingCoordinator{
 public:
     EncodingCoordinator();
@@ -22,6 +46,9 @@ public:
     void stop();
     bool isRunning() const { return is_running_; }
     void setAudioVideoSync(bool enable) { sync_av_ = enable; }
+    //在start之前设置
+    void setFrameDropConfig(const FrameDropConfig& config) { drop_config_ = config; }
+    FrameDropStats getFrameDropStats() const;
 private:
     void audioEncodingLoop();
     void videoEncodingLoop();
@@ -31,6 +58,8 @@ private:
     int64_t getVideoTimestamp();
 
     void syncTimestamps(AVPacket* pkt,AVMediaType type);
+    //过载时返回丢帧后应编码的序号，未过载返回frame_index
+    int64_t applyDropPolicy(VideoFrameBuffer* buffer,int64_t frame_index,bool& force_keyframe);
 
     MediaDataManager* data_manager_;
     AudioEncoder* audio_encoder_;
@@ -53,6 +82,13 @@ private:
     int64_t audio_pts_;
     int64_t video_pts_;
     std::mutex timestamp_mutex_;
+
+    FrameDropConfig drop_config_;
+    std::atomic<uint64_t> dropped_frames_{0};
+    std::atomic<uint64_t> drop_events_{0};
+    std::atomic<uint64_t> forced_keyframes_{0};
+    std::atomic<size_t> max_queue_frames_{0};
+    std::atomic<int64_t> max_latency_ns_{0};
 };
 
 #endif
\ No newline at end of file
@@ -5,7 +5,11 @@
 #include "AudioFilter.hpp"
 #include "VideoFilter.hpp"
 #include "FilterParams.hpp"
+#include "Avmuxer.hpp"
+#include "RawStreamReader.hpp"
+#include "BatchDecodeService.hpp"
 #include <optional>
+#include <vector>
 
 struct AudioFilterParamUpdate{
     std::optional<double> volume;
@@ -33,6 +37,11 @@ struct VideoFilterParamsUpdate{
     std::optional<int> blur_radius;
 };
 
+struct StreamRoute{
+    BaseDecoder* decoder = nullptr;
+    FrameWriter* writer = nullptr;
+};
+
 class FileManager {
 public:
     FileManager();
@@ -49,6 +58,33 @@ public:
                      BaseDecoder* decoder_audio,
                      BaseDecoder* decoder_video);
 
+    //编码一致时直接转封装，只做时间戳换算
+    void process_remux(const std::string& inputPath,
+                       const std::string& outputPath,
+                       Demuxer* demuxer,
+                       const std::string& format = "mp4");
+
+    //按关键帧切分为多段并行解码/滤镜/编码，再按顺序拼接为一个输出（仅视频）
+    void process_chunked(const std::string& inputPath,
+                         const std::string& outputPath,
+                         int workers = 0,
+                         int bit_rate = 4000000,
+                         const char* encoder_name = nullptr,
+                         const std::string& format = "mp4");
+
+    //按清单批量解码到outputDir，清单格式见BatchDecodeService::loadManifest
+    BatchStats process_batch(const std::string& manifestPath,
+                             const std::string& outputDir,
+                             int workers = 0);
+
+    //对process_mux传入的解码器及process_chunked内部解码器生效
+    void setDecoderThreadConfig(const DecoderThreadConfig& config) { decoderThreadConfig = config; }
+    //代理/预览任务可降低解码质量换速度；process_raw的解码器已打开，lowres对其不生效
+    void setDecodeQuality(DecodeQuality quality) { decodeQuality = quality; }
+
+    //process_raw每次映射/读取的窗口大小
+    void setRawReadWindow(size_t bytes) { rawReadWindow = bytes; }
+
     void updateFilterAudioParams(const AudioFilterParamUpdate& update);
     void updateFilterVideoParams(const VideoFilterParamsUpdate& update);
 
@@ -60,11 +96,30 @@ public:
 
 
 private:
+    //每段拥有从起始关键帧到下一段起始关键帧之间(解码顺序)的所有帧
+    //读取从前一个关键帧开始，使open GOP中排在起始关键帧之前显示的帧也能正确解码
+    struct ChunkRange{
+        int64_t start_pts;      // 流时间基，首段为AV_NOPTS_VALUE
+        int64_t end_pts;        // 下一段起始关键帧，末段为AV_NOPTS_VALUE
+        int64_t read_pts;       // 开始读取的关键帧，首段为AV_NOPTS_VALUE
+    };
+    struct ChunkResult{
+        bool ok = false;
+        std::vector<AVPacket*> packets;
+        AVCodecParameters* codecpar = nullptr;
+        AVRational time_base = {0, 1};
+    };
+    void transcodeChunk(const std::string& inputPath, const ChunkRange& range,
+                        int bit_rate, const char* encoder_name, int encoder_threads,
+                        ChunkResult& result);
+
     std::string buildOutputFilePath(const std::string& outputDir, const std::string& inputPath, const std::string& newSuffix);
-    void processVideo(FILE* inputFile, const std::string& inputPath,
+    bool feedRawStream(RawStreamReader& reader, BaseDecoder* decoder,
+                       AVPacket* pkt, const FrameCallback& onFrame);
+    void processVideo(RawStreamReader& reader, const std::string& inputPath,
                                const std::string& outputDir, BaseDecoder* decoder,
-                               AVPacket* pkt, uint8_t*& data, size_t& data_size);
-    void processAudio(FILE* inputFile, const std::string& inputPath,const std::string& outputDir, BaseDecoder* decoder,AVPacket* pkt, uint8_t*& data, size_t& data_size);
+                               AVPacket* pkt);
+    void processAudio(RawStreamReader& reader, const std::string& inputPath,const std::string& outputDir, BaseDecoder* decoder,AVPacket* pkt);
 
     AudioFilterParams currentParamsAudio;
     VideoFilterParams currentParamsVideo;
@@ -72,6 +127,10 @@ private:
     std::shared_ptr<AudioFilter> audioFilter = nullptr;
     std::shared_ptr<VideoFilter> videoFilter = nullptr;
 
+    DecoderThreadConfig decoderThreadConfig;
+    DecodeQuality decodeQuality = DecodeQuality::FULL;
+    size_t rawReadWindow = 16 * 1024 * 1024;
+
     bool enableAudioFilter = false;
     bool enableVideoFilter = false;
     
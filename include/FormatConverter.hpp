@@ -3,41 +3,68 @@
 
 extern "C"{
     #include <libswscale/swscale.h>
+    #include <libswscale/version.h>
     #include <libswresample/swresample.h>
     #include <libavutil/opt.h>
     #include <libavutil/imgutils.h>
     #include <libavutil/channel_layout.h>
     #include <libavutil/samplefmt.h>
     #include <libavutil/frame.h>
+    #include <libavutil/buffer.h>
+    #include <libavutil/cpu.h>
 }
+#include "ConverterCache.hpp"
 
 class MediaFormatConverter{
 public:
     MediaFormatConverter();
     ~MediaFormatConverter();
+    //视频转换线程数，在initVideoConverter之前设置；0为按分辨率和核数自动选择，1为单线程
+    //多线程走swscale自带的分片线程，只对引用计数的源帧生效
+    void setVideoThreads(int threads) { video_threads_ = threads; }
+    int getVideoThreads() const { return active_video_threads_; }
+    //设定输出格式，并按给定的源格式预先取好转换上下文
+    //之后每帧按源帧自身的尺寸/格式选路：与输出一致直接拷贝，源格式中途变化时从ConverterCache换上下文，不用重新init
     bool initVideoConverter(int src_width ,int src_height,AVPixelFormat& src_format,
                             int dst_width ,int dst_height,AVPixelFormat& dst_format);
 
+    //转换到dst_frame；dst没有可写缓冲时从内部池取，已有缓冲时尺寸格式必须与输出一致，直接覆盖
+    //循环中复用同一个dst即可做到每帧零分配
+    bool convertVideoInto(const AVFrame* src_frame, AVFrame* dst_frame);
+    //返回池化缓冲的新帧，av_frame_free后缓冲回到池中
     AVFrame* convertVideo(AVFrame* src_frame);
+    //同视频，源采样格式/采样率/声道布局变化时自动换重采样器，旧重采样器里缓存的延迟样本会被丢弃
     bool initAudioConverter(AVSampleFormat src_format, int src_sample_rate, AVChannelLayout&  src_layout,
                            AVSampleFormat dst_format, int dst_sample_rate, AVChannelLayout& dst_layout);
 
+    //dst已有可写缓冲且容量够时直接复用，否则从内部池取；转换后nb_samples为实际样本数
+    bool convertAudioInto(const AVFrame* src_frame, AVFrame* dst_frame);
     AVFrame* convertAudio(AVFrame* src_frame);
 
-    bool needVideoConversion() const { return video_converter_initialized_; }
-    bool needAudioConversion() const { return audio_converter_initialized_; }
+    //按init时给定的源格式判断
+    bool needVideoConversion() const { return video_converter_initialized_ && !video_key_.identity(); }
+    bool needAudioConversion() const { return audio_converter_initialized_ && !audio_key_.identity(); }
+    //按实际源帧判断，源格式会变化时用这一组
+    bool needVideoConversion(const AVFrame* frame) const;
+    bool needAudioConversion(const AVFrame* frame) const;
     
     void cleanup();
 private:
     SwsContext* sws_ctx_;
-    AVFrame* converted_video_frame_;
+    VideoConverterKey video_key_;   // sws_ctx_对应的转换参数
+    AVBufferPool* video_pool_;
     bool video_converter_initialized_;
     
+    int video_threads_;
+    int active_video_threads_;
     int dst_video_width_, dst_video_height_;
     AVPixelFormat dst_video_format_;
     
     SwrContext* swr_ctx_;
-    AVFrame* converted_audio_frame_;
+    AudioConverterKey audio_key_;   // 声道布局为深拷贝，换路时uninit
+    AVBufferPool* audio_pool_;
+    int audio_pool_samples_;        // 池中每块缓冲可容纳的样本数
+    int audio_linesize_;
     bool audio_converter_initialized_;
     
     AVSampleFormat dst_audio_format_;
@@ -45,8 +72,14 @@ private:
     AVChannelLayout dst_audio_layout_ ={};
     int max_dst_samples_;
     
-    bool allocateVideoFrame();
-    bool allocateAudioFrame(int nb_samples);
+    int resolveVideoThreads(int height) const;
+    bool selectVideoRoute(int src_width, int src_height, AVPixelFormat src_format);
+    bool selectAudioRoute(AVSampleFormat src_format, int src_sample_rate, const AVChannelLayout& src_layout);
+    void releaseVideoRoute();
+    void releaseAudioRoute();
+    bool initVideoPool();
+    bool getVideoBuffer(AVFrame* frame);
+    bool getAudioBuffer(AVFrame* frame, int nb_samples);
 };
 
 #endif
\ No newline at end of file
@@ -4,6 +4,11 @@
 #include <memory>
 #include <vector>
 #include <atomic>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+#include "SpillFile.hpp"
 
 extern "C" {
 #include <libavutil/avutil.h>
@@ -12,50 +17,228 @@ extern "C" {
 #include <libavutil/samplefmt.h>
 }
 
+//生产者提交数据后唤醒阻塞的消费者
+//没有等待者时notify只多一次原子读，不碰锁
+class FrameSignal{
+public:
+    //ready在锁内检查；返回ready()的结果，超时或wakeAll时可能为false
+    template<typename Pred>
+    bool waitFor(Pred ready,int timeout_ms){
+        if(ready()){
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiters_.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t gen = wake_gen_.load();
+        cv_.wait_for(lock,std::chrono::milliseconds(timeout_ms),[&]{
+            return ready() || wake_gen_.load() != gen;
+        });
+        waiters_.fetch_sub(1);
+        return ready();
+    }
+    void notify(){
+        //与waitFor中的fetch_add配对，保证不会漏掉刚进入等待的消费者
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(waiters_.load() > 0){
+            std::lock_guard<std::mutex> lock(mutex_);
+            cv_.notify_all();
+        }
+    }
+    //让所有等待立即返回，用于停止
+    void wakeAll(){
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_gen_.fetch_add(1);
+        cv_.notify_all();
+    }
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<int> waiters_{0};
+    std::atomic<uint64_t> wake_gen_{0};
+};
+
+//溢出统计，时间单位纳秒
+struct SpillStats{
+    uint64_t frames = 0;            // 累计写入溢出区的帧数
+    uint64_t bytes = 0;
+    size_t pending_frames = 0;      // 当前仍在溢出区的帧数
+    uint64_t write_ns_total = 0;
+    uint64_t write_ns_max = 0;
+    uint64_t page_ins = 0;          // 从溢出区取帧的次数
+    uint64_t page_in_ns_total = 0;
+    uint64_t page_in_ns_max = 0;
+};
+
+//固定容量的视频帧环形缓冲：单生产者/单消费者，无锁
+//帧按写入序号编号；取出的帧以AVBufferRef引用槽位，最后一个引用释放前槽位不会被覆盖
+//环满时生产者丢弃新帧；启用溢出后先写入mmap溢出文件，溢出区也满了才丢弃
 class VideoFrameBuffer{
 public:
-    VideoFrameBuffer(int width,int height,AVPixelFormat pix_fmt = AV_PIX_FMT_YUV420P);
+    VideoFrameBuffer(int width,int height,AVPixelFormat pix_fmt = AV_PIX_FMT_YUV420P,size_t capacity = 60);
     ~VideoFrameBuffer();
 
     bool addFrame(const uint8_t* frame_data,size_t data_size);
     bool addFrame(AVFrame*frame);
 
-    bool getFrame(int frame_index, uint8_t*& frame_data);
-    AVFrame* getAVFrame(int frame_index);
+    //返回引用计数的只读帧，buf[0]指向槽位内存；只能由消费者线程按序号递增调用
+    //帧及其引用(如编码器的前瞻队列)必须在缓冲销毁前释放
+    AVFrame* getAVFrame(int64_t frame_index);
+    //释放帧并立即推进消费游标；直接av_frame_free也可以，游标在下一次getAVFrame时推进
+    void releaseFrame(AVFrame*& frame);
+    //阻塞到frame_index可取或超时
+    bool waitForFrame(int64_t frame_index,int timeout_ms);
+    //帧写入缓冲时的steady_clock时刻(纳秒)，帧不在缓冲中时返回-1；仅消费者线程调用
+    int64_t getEnqueueTime(int64_t frame_index);
+    void wakeConsumers() {signal_.wakeAll();}
+
+    //在开始写入前调用；max_bytes按帧向下取整，不足一帧时不启用
+    bool enableSpill(const std::string& dir,size_t max_bytes);
 
-    int getFrameCount() const {return frame_count_;}
+    int64_t getFrameCount() const {return write_count_.load(std::memory_order_acquire);}
+    int64_t getReadIndex() const {return read_index_.load(std::memory_order_acquire);}
+    size_t getCapacity() const {return capacity_;}
+    size_t getBufferedFrames() const;
+    size_t getCapacityBytes() const {return capacity_ * frame_size_;}
+    uint64_t getDroppedFrames() const {return dropped_.load(std::memory_order_relaxed);}
+    size_t getFrameSize() const {return frame_size_;}
+    size_t getSpillCapacity() const {return spill_capacity_;}
+    size_t getSpilledFrames() const;
+    SpillStats getSpillStats() const;
+    //仅在没有消费者持有帧时调用
     void clear();
 private:
+    struct Slot{
+        std::atomic<int> refs{0};
+        std::atomic<int64_t> seq{-1};
+        std::atomic<int64_t> stamp{0};      // 提交时刻，steady_clock纳秒
+        uint8_t* data = nullptr;
+    };
+    Slot& slotFor(int64_t index) {return slots_[(size_t)(index % (int64_t)capacity_)];}
+    Slot& spillSlotFor(int64_t pos) {return spill_slots_[(size_t)(pos % (int64_t)spill_capacity_)];}
+    //序号所在的槽位，内存环优先，其次溢出区；不存在时返回空
+    Slot* locate(int64_t index);
+    static void releaseSlot(void* opaque,uint8_t* data);
+    Slot* reserveSlot(int64_t& seq,bool& spilled);
+    void commitSlot(Slot* slot,int64_t seq,bool spilled,uint64_t write_ns);
+    void advanceReadIndex();
+    void pageIn(Slot* slot);
+
     int width_;
     int height_;
-    int frame_count_;
     size_t frame_size_;
-    std::vector<uint8_t> buffer_;
     AVPixelFormat pix_fmt_;
+    size_t capacity_;
+    size_t slot_stride_;
+    uint8_t* storage_ = nullptr;
+    std::unique_ptr<Slot[]> slots_;
+
+    std::atomic<int64_t> write_count_{0};   // 只由生产者修改
+    std::atomic<int64_t> read_index_{0};    // 只由消费者修改，最旧的未释放序号
+    int64_t consumed_ = 0;                  // 消费者已取走或释放到的序号+1
+    std::atomic<uint64_t> dropped_{0};
+
+    //溢出区：按写入顺序排队的槽位，槽位起始按页对齐
+    SpillFile spill_file_;
+    std::unique_ptr<Slot[]> spill_slots_;
+    size_t spill_capacity_ = 0;
+    size_t spill_stride_ = 0;
+    std::atomic<int64_t> spill_write_{0};   // 只由生产者修改
+    std::atomic<int64_t> spill_read_{0};    // 只由消费者修改
+    std::atomic<uint64_t> spill_frames_{0};
+    std::atomic<uint64_t> spill_write_ns_{0};
+    std::atomic<uint64_t> spill_write_ns_max_{0};
+    std::atomic<uint64_t> page_ins_{0};
+    std::atomic<uint64_t> page_in_ns_{0};
+    std::atomic<uint64_t> page_in_ns_max_{0};
 
+    FrameSignal signal_;
 };
 
+//按样本计容量的音频环形缓冲：单生产者/单消费者，无锁
+//按采样格式原样存储，planar每个声道一个环，packed一个环，读写都是整块拷贝
 class AudioFrameBuffer{
 public:
-    AudioFrameBuffer(int sample_rate ,int channels, AVSampleFormat sample_fmt);
+    //capacity_samples为0时按2秒分配
+    AudioFrameBuffer(int sample_rate ,int channels, AVSampleFormat sample_fmt, size_t capacity_samples = 0);
     ~AudioFrameBuffer();
 
-    bool getSamples(int start_sample,int nb_samples,uint8_t*& sample_data);
-    AVFrame* getAVFrame(int start_sample,int nb_samples);
+    //拷贝出nb_samples个样本到dst(planar每个声道一个指针)并消费，不足时返回false
+    bool readSamples(uint8_t* const* dst,int nb_samples);
+    //取从start_sample开始的nb_samples个样本并消费；start早于读位置时返回空，晚于时跳过中间样本
+    AVFrame* getAVFrame(int64_t start_sample,int nb_samples);
+    //阻塞到[start_sample,start_sample+nb_samples)都已写入或超时
+    bool waitForSamples(int64_t start_sample,int nb_samples,int timeout_ms);
+    void wakeConsumers() { signal_.wakeAll(); }
 
+    //sample_data为交错排列的PCM
     bool addFrame(const uint8_t* sample_data,int nb_samples);
     bool addFrame(AVFrame* frame);
 
+    size_t getCapacity() const { return capacity_; }
+    size_t getFillLevel() const;
+    int64_t getWritePosition() const { return write_pos_.load(std::memory_order_acquire); }
+    int64_t getReadPosition() const { return read_pos_.load(std::memory_order_acquire); }
+    //水位以样本数计，供生产者限速、消费者判断是否欠载
+    void setWatermarks(size_t low,size_t high) { low_watermark_ = low; high_watermark_ = high; }
+    bool aboveHighWatermark() const { return getFillLevel() >= high_watermark_; }
+    bool belowLowWatermark() const { return getFillLevel() <= low_watermark_; }
+    size_t getPeakFill() const { return peak_fill_.load(std::memory_order_relaxed); }
+    size_t getCapacityBytes() const { return storage_.size(); }
+    size_t getBufferedBytes() const { return getFillLevel() * channels_ * bytes_per_sample_; }
+    uint64_t getOverflowSamples() const { return overflow_samples_.load(std::memory_order_relaxed); }
+
+    //仅在生产者和消费者都停止时调用
     void clear();
 
 private:
-    int nb_samples_;
+    void copyIn(const uint8_t* const* src,int64_t pos,int nb_samples);
+    void copyOut(uint8_t* const* dst,int64_t pos,int nb_samples) const;
+    bool reserve(int nb_samples);
+    void commit(int nb_samples);
+
     int sample_rate_;
     int channels_;
     AVSampleFormat sample_fmt_;
     int bytes_per_sample_;
-    std::vector<uint8_t> buffer_;
-    int total_samples_;
+    bool planar_;
+    int planes_;
+    int plane_sample_bytes_;        // 单个环中一个样本的字节数
+    size_t capacity_;
+    std::vector<uint8_t> storage_;
+    std::vector<uint8_t*> rings_;
+    std::vector<uint8_t*> write_ptrs_;     // 交错输入拆声道时的目标指针，构造时定长，生产者路径不再分配
+
+    std::atomic<int64_t> write_pos_{0};     // 只由生产者修改
+    std::atomic<int64_t> read_pos_{0};      // 只由消费者修改
+    size_t low_watermark_;
+    size_t high_watermark_;
+    std::atomic<size_t> peak_fill_{0};
+    std::atomic<uint64_t> overflow_samples_{0};
+
+    FrameSignal signal_;
+};
+
+//内存预算：限制两个缓冲常驻内存的总量，视频超出部分可溢出到磁盘
+struct MemoryBudget{
+    size_t max_resident_bytes = 0;  // 0为不限制，沿用各缓冲的默认容量
+    size_t max_spill_bytes = 0;     // 0为不溢出，超出预算的视频帧直接丢弃
+    std::string spill_dir = "/tmp";
+    double audio_share = 0.05;      // 预算中分给音频环的比例
+};
+
+struct MemoryStats{
+    size_t budget_bytes = 0;
+    size_t reserved_bytes = 0;      // 已分配的常驻缓冲
+    size_t resident_bytes = 0;      // 常驻缓冲中尚未消费的数据
+    size_t spilled_bytes = 0;       // 溢出区中尚未消费的数据
+    uint64_t spilled_total_bytes = 0;
+    uint64_t dropped_video_frames = 0;
+    uint64_t overflow_audio_samples = 0;
+    double spill_write_avg_us = 0.0;
+    double spill_write_max_us = 0.0;
+    double page_in_avg_us = 0.0;
+    double page_in_max_us = 0.0;
 };
 
 class MediaDataManager {
@@ -63,8 +246,12 @@ public:
     MediaDataManager() = default;
     ~MediaDataManager() = default;
 
-    bool initVideoBuffer(int width, int height, AVPixelFormat pix_fmt = AV_PIX_FMT_YUV420P);
-    bool initAudioBuffer(int sample_rate, int channels, AVSampleFormat sample_fmt = AV_SAMPLE_FMT_S32);
+    //在init*Buffer之前调用；预算会压低各缓冲的容量参数
+    void setMemoryBudget(const MemoryBudget& budget) { budget_ = budget; }
+    const MemoryBudget& getMemoryBudget() const { return budget_; }
+
+    bool initVideoBuffer(int width, int height, AVPixelFormat pix_fmt = AV_PIX_FMT_YUV420P, size_t capacity = 60);
+    bool initAudioBuffer(int sample_rate, int channels, AVSampleFormat sample_fmt = AV_SAMPLE_FMT_S32, size_t capacity_samples = 0);
 
     VideoFrameBuffer* getVideoBuffer() { return video_buffer_.get(); }
     AudioFrameBuffer* getAudioBuffer() { return audio_buffer_.get(); }
@@ -72,9 +259,14 @@ public:
     bool hasVideo() const { return video_buffer_ != nullptr; }
     bool hasAudio() const { return audio_buffer_ != nullptr; }
 
+    MemoryStats getMemoryStats() const;
+    //唤醒所有阻塞在两个缓冲上的消费者
+    void wakeConsumers();
+
     void clearAll();
 
 private:
+    MemoryBudget budget_;
     std::unique_ptr<VideoFrameBuffer> video_buffer_;
     std::unique_ptr<AudioFrameBuffer> audio_buffer_;
 
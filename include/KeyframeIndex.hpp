@@ -0,0 +1,37 @@
+#ifndef KEYFRAMEINDEX
+#define KEYFRAMEINDEX
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+extern "C"{
+    #include <libavformat/avformat.h>
+}
+
+//视频流关键帧索引，可持久化为输入文件旁的sidecar文件
+class KeyframeIndex{
+public:
+    struct Entry{
+        int64_t pts;   // 流时间基
+        int64_t pos;   // 文件字节偏移，未知为-1
+    };
+
+    //扫描整个文件，调用方负责之后的回绕
+    bool build(AVFormatContext* fmt_ctx);
+    bool load(const std::string& path,int64_t file_size,int64_t mtime);
+    bool save(const std::string& path,int64_t file_size,int64_t mtime) const;
+
+    //返回pts不大于目标的最后一个关键帧
+    const Entry* lookup(int stream_index,int64_t pts) const;
+    const std::vector<Entry>* entries(int stream_index) const;
+    bool empty() const { return streams_.empty(); }
+    void clear() { streams_.clear(); }
+
+    static std::string sidecarPath(const std::string& input_path) { return input_path + ".kidx"; }
+
+private:
+    std::map<int,std::vector<Entry>> streams_;
+};
+
+#endif
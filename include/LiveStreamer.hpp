@@ -38,6 +38,9 @@ public:
         int video_bitrate = -1;
         AVCodecID video_codec = AV_CODEC_ID_NONE;
         AVPixelFormat video_fmt = AV_PIX_FMT_YUV420P;
+        int video_buffer_frames = 60;   // 视频环形缓冲容量，满时丢弃新帧
+        MemoryBudget memory_budget;     // 缓冲常驻内存上限和溢出文件大小，默认不限制
+        FrameDropConfig frame_drop;     // 编码跟不上时的丢帧策略，默认不主动丢帧
 
         std::string rtmp_url;
         std::string output_format = "mp4";
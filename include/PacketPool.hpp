@@ -0,0 +1,53 @@
+#ifndef PACKETPOOL
+#define PACKETPOOL
+
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+#include <atomic>
+extern "C"{
+    #include <libavcodec/avcodec.h>
+}
+
+//AVPacket复用池：线程本地缓存 + 全局空闲链表，线程安全
+class PacketPool{
+public:
+    struct Stats{
+        uint64_t hits = 0;       // 从缓存取到
+        uint64_t misses = 0;     // 需要av_packet_alloc
+        uint64_t releases = 0;
+        size_t global_free = 0;
+    };
+
+    static PacketPool& instance();
+
+    AVPacket* acquire();
+    //unref后归还，并将调用方指针置空
+    void release(AVPacket*& pkt);
+
+    Stats getStats() const;
+    void setLimits(size_t per_thread,size_t global);
+
+private:
+    PacketPool() = default;
+    ~PacketPool();
+    PacketPool(const PacketPool&) = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+
+    struct ThreadCache{
+        std::vector<AVPacket*> packets;
+        ~ThreadCache();
+    };
+    static ThreadCache& threadCache();
+    void returnToGlobal(std::vector<AVPacket*>& packets,size_t keep);
+
+    mutable std::mutex mutex_;
+    std::vector<AVPacket*> free_list_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> releases_{0};
+    std::atomic<size_t> thread_cache_limit_{64};
+    std::atomic<size_t> global_limit_{4096};
+};
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef RAWSTREAMREADER
+#define RAWSTREAMREADER
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+extern "C"{
+    #include <libavcodec/avcodec.h>
+}
+
+//裸码流(.h264/.aac等)分窗口读取，直接把映射页交给av_parser_parse2
+//普通文件按窗口mmap；无法映射时(管道、stdin)退回大块read
+class RawStreamReader{
+public:
+    explicit RawStreamReader(size_t window_size = 16 * 1024 * 1024);
+    ~RawStreamReader();
+
+    bool open(const std::string& path);
+    //取下一个窗口，data之后至少有AV_INPUT_BUFFER_PADDING_SIZE字节可读；只读，结束或出错返回false
+    bool next(uint8_t*& data,size_t& size);
+    //next返回false后区分原因：0为正常读到文件尾，否则为读取/映射失败的errno
+    int error() const { return error_; }
+    void close();
+
+    bool isMapped() const { return mapped_; }
+    uint64_t getFileSize() const { return file_size_; }
+
+private:
+    void unmapWindow();
+
+    size_t window_size_;
+    int fd_ = -1;
+    bool owns_fd_ = false;
+    bool mapped_ = false;
+    uint64_t file_size_ = 0;
+    uint64_t offset_ = 0;
+    int error_ = 0;
+    uint8_t* map_ = nullptr;
+    size_t map_len_ = 0;
+    std::vector<uint8_t> buffer_;     // 末窗口或非映射模式，尾部补零
+};
+
+#endif
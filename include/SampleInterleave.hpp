@@ -0,0 +1,25 @@
+#ifndef SAMPLEINTERLEAVE
+#define SAMPLEINTERLEAVE
+
+#include <stdint.h>
+#include <stddef.h>
+
+//planar <-> packed音频样本重排，只按位宽搬运，int16/int32/float通用
+//双声道16/32位走SIMD(SSE2/AVX2运行时选择，ARM上NEON)，6/8声道16/32位走SSE2或NEON的块转置
+//单声道直接memcpy，其余声道数走按声道数展开的标量版本
+class SampleInterleave{
+public:
+    //src[ch]各声道 -> dst交错
+    static void interleave(uint8_t* dst,const uint8_t* const* src,int channels,int nb_samples,int bytes_per_sample);
+    //src交错 -> dst[ch]各声道
+    static void deinterleave(uint8_t* const* dst,const uint8_t* src,int channels,int nb_samples,int bytes_per_sample);
+
+    //当前使用的内核："avx2"、"sse2"、"neon"或"scalar"
+    static const char* kernelName();
+
+    //纯标量实现，用于对照和测试
+    static void interleaveScalar(uint8_t* dst,const uint8_t* const* src,int channels,int nb_samples,int bytes_per_sample);
+    static void deinterleaveScalar(uint8_t* const* dst,const uint8_t* src,int channels,int nb_samples,int bytes_per_sample);
+};
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef SPILLFILE
+#define SPILLFILE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+//mmap的临时文件，作为内存预算之外的溢出区
+//创建后立即unlink，进程退出时自动回收；页面由内核按需换入换出
+class SpillFile{
+public:
+    SpillFile() = default;
+    ~SpillFile();
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    bool open(const std::string& dir,size_t size);
+    void close();
+
+    uint8_t* data() const { return map_; }
+    size_t size() const { return size_; }
+    bool isOpen() const { return map_ != nullptr; }
+
+    //即将读取的区间提前换入
+    void prefetch(size_t offset,size_t len);
+    //区间内容不再需要，丢弃对应页面
+    void discard(size_t offset,size_t len);
+
+private:
+    bool pageRange(size_t& offset,size_t& len) const;
+
+    int fd_ = -1;
+    uint8_t* map_ = nullptr;
+    size_t size_ = 0;
+    size_t page_ = 4096;
+};
+
+#endif
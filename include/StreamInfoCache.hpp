@@ -0,0 +1,67 @@
+#ifndef STREAMINFOCACHE
+#define STREAMINFOCACHE
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+extern "C"{
+    #include <libavformat/avformat.h>
+}
+
+//按文件指纹缓存avformat_find_stream_info的结果，再次打开同一文件时跳过探测
+class StreamInfoCache{
+public:
+    struct Fingerprint{
+        int64_t size = 0;
+        int64_t mtime = 0;
+        uint64_t head_hash = 0;   // 文件头64KB的FNV-1a
+        std::string key() const;
+    };
+
+    //编码参数保存完整的avcodec_parameters_copy副本，命中时与真实探测结果一致
+    struct StreamInfo{
+        std::shared_ptr<AVCodecParameters> codecpar;
+        AVRational time_base = {0,1};
+        AVRational avg_frame_rate = {0,1};
+        AVRational r_frame_rate = {0,1};
+        AVRational sample_aspect_ratio = {0,1};
+        int64_t start_time = AV_NOPTS_VALUE;
+        int64_t duration = AV_NOPTS_VALUE;
+        int64_t nb_frames = 0;
+    };
+
+    struct ProbeInfo{
+        int64_t start_time = AV_NOPTS_VALUE;
+        int64_t duration = AV_NOPTS_VALUE;
+        int64_t bit_rate = 0;
+        std::vector<StreamInfo> streams;
+        //含磁盘格式表示不了的字段(自定义声道布局、编码端side data)时只缓存在内存中
+        bool persistable = true;
+    };
+
+    static StreamInfoCache& shared();
+
+    static bool fingerprint(const std::string& path,Fingerprint& fp);
+    //拷贝编码参数失败时返回false，不缓存
+    static bool capture(const AVFormatContext* fmt_ctx,ProbeInfo& info);
+    //流数量或类型与缓存不一致、参数无法完整恢复时返回false，调用方应回退到完整探测
+    static bool apply(AVFormatContext* fmt_ctx,const ProbeInfo& info);
+
+    //设置后缓存同时持久化到该目录
+    void setCacheDir(const std::string& dir);
+    bool lookup(const Fingerprint& fp,ProbeInfo& info);
+    void store(const Fingerprint& fp,const ProbeInfo& info);
+
+private:
+    bool loadFromDisk(const std::string& key,ProbeInfo& info);
+    void saveToDisk(const std::string& key,const ProbeInfo& info);
+
+    std::mutex mutex_;
+    std::map<std::string,ProbeInfo> entries_;
+    std::string cache_dir_;
+};
+
+#endif
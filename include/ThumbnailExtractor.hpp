@@ -0,0 +1,60 @@
+#ifndef THUMBNAILEXTRACTOR
+#define THUMBNAILEXTRACTOR
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+extern "C"{
+    #include <libavcodec/avcodec.h>
+    #include <libswscale/swscale.h>
+}
+
+class Demuxer;
+class videoDecoder;
+
+enum class ThumbnailFormat { JPEG, PNG };
+
+struct ThumbnailOptions{
+    int count = 10;                 // 在时长内均匀取点
+    double interval = 0.0;          // 秒，大于0时改为按间隔取点，count作为上限
+    int width = 320;                // 高度按比例，0保持原尺寸
+    ThumbnailFormat format = ThumbnailFormat::JPEG;
+    int jpeg_quality = 5;           // mjpeg qscale，2最好，31最差
+    int workers = 0;                // 0为核数
+    bool sprite = false;            // 拼成一张雪碧图，而不是每点一张
+    int sprite_columns = 5;
+};
+
+//只解码关键帧的缩略图提取：decoder跳过非关键帧，取点之间靠demuxer定位
+class ThumbnailExtractor{
+public:
+    explicit ThumbnailExtractor(const ThumbnailOptions& options);
+
+    //返回写出的图片数
+    int extract(const std::string& inputPath,const std::string& outputDir);
+
+private:
+    struct Sample{
+        int64_t target = 0;         // AV_TIME_BASE
+        int64_t pts = AV_NOPTS_VALUE;   // 实际取到的关键帧，AV_TIME_BASE
+        AVFrame* image = nullptr;   // 缩放后的输出格式帧
+        bool written = false;
+        int tile = -1;              // 雪碧图中的格子序号，未放入为-1
+    };
+
+    //单个worker：独立的demuxer/解码器/缩放上下文；非雪碧图模式下直接编码写出
+    void extractRange(const std::string& inputPath,const std::string& prefix,
+                      std::vector<Sample>& samples,size_t begin,size_t end,int decoder_threads);
+    bool grab(Demuxer& demuxer,videoDecoder& decoder,SwsContext*& sws,Sample& sample);
+    AVFrame* scale(SwsContext*& sws,const AVFrame* frame);
+    //按第一帧尺寸拼图，并给放入的取点编号tile
+    AVFrame* buildSprite(std::vector<Sample>& samples);
+    bool writeImage(AVFrame* image,const std::string& path);
+
+    AVPixelFormat outputPixFmt() const;
+    const char* extension() const;
+
+    ThumbnailOptions options_;
+};
+
+#endif
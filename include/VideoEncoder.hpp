@@ -11,6 +11,7 @@ extern "C"{
     #include <libavutil/imgutils.h>
 }
 #include "BaseEncoder.hpp"
+#include "PacketPool.hpp"
 
 
 class VideoEncoder:public BaseEncoder{
@@ -21,6 +22,8 @@ public:
     void close() override;
     void setVideoParams(int width,int height,int bit_rate,int fps);
     void setPixelFormat(AVPixelFormat pix_fmt) { target_pix_fmt_ = pix_fmt; }
+    //未设置时时间基为{1,fps}，帧率为{fps,1}
+    void setTimeBase(AVRational time_base, AVRational framerate = {0, 1}) { time_base_ = time_base; framerate_ = framerate; }
     void setQuality(const std::string& preset = "medium", int crf = -1);
     int encode(AVFrame* encode_frame) override;
 
@@ -30,9 +33,11 @@ private:
     int bit_rate_;
     int fps_;
     AVPixelFormat target_pix_fmt_ = AV_PIX_FMT_YUV420P;
+    AVRational time_base_ = {0, 1};
+    AVRational framerate_ = {0, 1};
     std::string preset_ = "medium";
 
-    int crf_;
+    int crf_ = -1;
 };
 
 #endif
\ No newline at end of file
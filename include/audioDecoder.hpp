@@ -1,3 +1,6 @@
+#ifndef AUDIODECODER_HPP
+#define AUDIODECODER_HPP
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
@@ -29,3 +32,5 @@ class AudioDecoder :public BaseDecoder{
     private:
         enum AVSampleFormat sfmt;
 };
+
+#endif
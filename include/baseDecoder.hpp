@@ -5,13 +5,40 @@
 #include <iostream>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <algorithm>
+#include <memory>
+#include "DecoderFramePool.hpp"
  extern "C"{
     #include <libavcodec/avcodec.h>
     #include <libavformat/avformat.h>
  }
  #define INBUF_SIZE 4096
 
+ //解码线程配置，需在initialize_*之前设置
+ struct DecoderThreadConfig{
+    bool auto_tune = true;      // 按分辨率、编解码器能力和核数自动选择
+    int thread_count = 0;       // 手动模式下生效，0交给libavcodec决定
+    int thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    int max_threads = 0;        // 自动模式上限，0为全部核；多个解码器并行时应分摊
+    bool low_delay = false;     // 自动模式下优先slice线程，避免帧线程带来的延迟
+ };
+
+ //解码质量档位，越往后越快、画质越差
+ enum class DecodeQuality {
+    FULL,       // 完整解码
+    FAST,       // AV_CODEC_FLAG2_FAST，非参考帧跳过环路滤波
+    PREVIEW,    // 跳过全部环路滤波，非参考帧跳过IDCT，lowres=1
+    PROXY       // 在PREVIEW基础上B帧也跳过IDCT，lowres=2
+ };
+
+ //返回false表示消费者不再需要本批剩余的帧
+ using FrameCallback = std::function<bool(AVFrame*)>;
+
  class BaseDecoder {
     public:
       BaseDecoder();
@@ -19,11 +46,30 @@
       bool isInitialized() {return isinit;}
       bool initialize_raw(AVCodecID codec_id);
       bool initialize_fromstream(AVCodecParameters* codecpar);
+      //编码参数与上次初始化一致时复用已打开的AVCodecContext，只清空内部状态
+      bool reuseForStream(const AVCodecParameters* codecpar);
       virtual bool parsePacket(uint8_t *&inbuf, size_t& size,AVPacket* pkt) = 0;
       virtual bool sendPacketAndReceiveFrame(AVPacket* pkt) = 0;
       virtual AVFrame* getFrame() const = 0;
       int set_parameter_bystreams(AVStream* st);
       virtual bool flush() = 0;
+      //送入一个包并取出全部可用帧，pkt为nullptr时等价于drain；返回交付帧数，出错为负
+      int decode(AVPacket* pkt, const FrameCallback& on_frame);
+      //取出解码器中当前所有可用帧，先全部取出再批量交付
+      int receiveFrames(const FrameCallback& on_frame);
+      //冲刷解码器直到EOF，之后解码器可继续接收新包
+      int drain(const FrameCallback& on_frame);
+      void setThreadConfig(const DecoderThreadConfig& config) { thread_config_ = config; }
+      const DecoderThreadConfig& getThreadConfig() const { return thread_config_; }
+      //视频输出帧改由分级缓冲池分配，需在initialize_*之前设置
+      void setFramePoolConfig(const FramePoolConfig& config) { frame_pool_config_ = config; }
+      //AVDISCARD_NONKEY时只解码关键帧，可随时修改
+      void setSkipFrame(AVDiscard skip) { skip_frame_ = skip; if (c) c->skip_frame = skip; }
+      //lowres只能在打开前设置，其余选项在已打开的解码器上立即生效
+      void setDecodeQuality(DecodeQuality quality);
+      DecodeQuality getDecodeQuality() const { return quality_; }
+      //实际生效的lowres，输出帧宽高为原始的1/(1<<lowres)
+      int getLowres() const { return c ? c->lowres : 0; }
       virtual int get_bytes_per_sample() const { return 0; }
       virtual int get_channels() const { return 0; }
       AVCodecID  get_codec_id() const {return codec->id;}
@@ -36,6 +82,17 @@
         AVCodecContext *c= NULL;
         AVCodecParserContext *parser = NULL;
         AVFrame *decoded_frame = NULL;
+        std::vector<AVFrame*> frame_batch_;
+        DecoderThreadConfig thread_config_;
+        FramePoolConfig frame_pool_config_;
+        std::unique_ptr<DecoderFramePool> frame_pool_;    // 在c之后析构
+        AVCodecParameters* init_params_ = nullptr;
+        AVDiscard skip_frame_ = AVDISCARD_DEFAULT;
+        DecodeQuality quality_ = DecodeQuality::FULL;
+
+        void applyThreadConfig();
+        void applyDecodeOptions(bool opened);
+        void attachFramePool();
  };
 
 inline int BaseDecoder::set_parameter_bystreams(AVStream* st){
@@ -74,6 +131,9 @@ inline bool BaseDecoder::initialize_raw(AVCodecID codec_id){
         exit(1);
     }
  
+    applyDecodeOptions(false);
+    applyThreadConfig();
+    attachFramePool();
     /* open it */
     if (avcodec_open2(c, codec, NULL) < 0) {
         fprintf(stderr, "Could not open codec\n");
@@ -98,6 +158,12 @@ inline bool BaseDecoder::initialize_raw(AVCodecID codec_id){
 }
 
 inline bool BaseDecoder::initialize_fromstream(AVCodecParameters* codecpar){
+    //重新初始化时先释放旧的上下文
+    avcodec_free_context(&c);
+    av_frame_free(&decoded_frame);
+    avcodec_parameters_free(&init_params_);
+    isinit = false;
+
   codec = avcodec_find_decoder(codecpar->codec_id);
     if (!codec) {
         fprintf(stderr, "Codec not found\n");
@@ -115,6 +181,9 @@ inline bool BaseDecoder::initialize_fromstream(AVCodecParameters* codecpar){
         return false;
     }
 
+    applyDecodeOptions(false);
+    applyThreadConfig();
+    attachFramePool();
     if (avcodec_open2(c, codec, NULL) < 0) {
         fprintf(stderr, "Could not open codec\n");
         return false;
@@ -126,18 +195,210 @@ inline bool BaseDecoder::initialize_fromstream(AVCodecParameters* codecpar){
         return false;
     }
 
+    init_params_ = avcodec_parameters_alloc();
+    if (init_params_ && avcodec_parameters_copy(init_params_, codecpar) < 0) {
+        avcodec_parameters_free(&init_params_);
+    }
+
     isinit = true;
     return true;
 }
 
+inline bool BaseDecoder::reuseForStream(const AVCodecParameters* codecpar){
+    const AVCodecParameters* p = init_params_;
+    if (!isinit || !c || !p || !codecpar) {
+        return false;
+    }
+    if (p->codec_id != codecpar->codec_id || p->codec_tag != codecpar->codec_tag ||
+        p->profile != codecpar->profile || p->format != codecpar->format ||
+        p->width != codecpar->width || p->height != codecpar->height ||
+        p->sample_rate != codecpar->sample_rate ||
+        av_channel_layout_compare(&p->ch_layout, &codecpar->ch_layout) != 0) {
+        return false;
+    }
+    //SPS/PPS等头信息不同则必须重新打开
+    if (p->extradata_size != codecpar->extradata_size ||
+        (p->extradata_size > 0 && memcmp(p->extradata, codecpar->extradata, p->extradata_size) != 0)) {
+        return false;
+    }
+    avcodec_flush_buffers(c);
+    return true;
+}
+
+
 
 
+inline void BaseDecoder::applyThreadConfig(){
+    if (!thread_config_.auto_tune) {
+        c->thread_count = thread_config_.thread_count;
+        c->thread_type = thread_config_.thread_type;
+        return;
+    }
+
+    bool frame_caps = codec->capabilities & AV_CODEC_CAP_FRAME_THREADS;
+    bool slice_caps = codec->capabilities & AV_CODEC_CAP_SLICE_THREADS;
+    bool other_caps = codec->capabilities & AV_CODEC_CAP_OTHER_THREADS;   // 如libdav1d，自行管理线程
+    if (codec->type != AVMEDIA_TYPE_VIDEO || (!frame_caps && !slice_caps && !other_caps)) {
+        c->thread_count = 1;
+        return;
+    }
+
+    int cores = (int)std::max(1u, std::thread::hardware_concurrency());
+    if (thread_config_.max_threads > 0) {
+        cores = std::min(cores, thread_config_.max_threads);
+    }
+    //裸流解码时分辨率未知，按1080p处理
+    int64_t pixels = (int64_t)c->width * c->height;
+    if (pixels <= 0) {
+        pixels = 1920 * 1080;
+    }
+    int wanted;
+    if (pixels >= 3840 * 2160) {
+        wanted = 16;
+    } else if (pixels >= 1920 * 1080) {
+        wanted = 8;
+    } else if (pixels >= 1280 * 720) {
+        wanted = 4;
+    } else {
+        wanted = 2;
+    }
+    c->thread_count = std::max(1, std::min(cores, wanted));
+
+    //帧线程吞吐更高但每个线程增加一帧延迟；slice线程依赖码流本身的分片数
+    bool low_delay = thread_config_.low_delay || (c->flags & AV_CODEC_FLAG_LOW_DELAY);
+    if (frame_caps && (!low_delay || !slice_caps)) {
+        c->thread_type = FF_THREAD_FRAME;
+    } else {
+        c->thread_type = FF_THREAD_SLICE;
+    }
+}
+
+inline void BaseDecoder::setDecodeQuality(DecodeQuality quality){
+    quality_ = quality;
+    if (c) {
+        applyDecodeOptions(true);
+    }
+}
+
+inline void BaseDecoder::applyDecodeOptions(bool opened){
+    c->skip_frame = skip_frame_;
+    c->flags2 &= ~AV_CODEC_FLAG2_FAST;
+    c->skip_loop_filter = AVDISCARD_DEFAULT;
+    c->skip_idct = AVDISCARD_DEFAULT;
+    int lowres = 0;
+    switch (quality_) {
+        case DecodeQuality::FULL:
+            break;
+        case DecodeQuality::FAST:
+            c->flags2 |= AV_CODEC_FLAG2_FAST;
+            c->skip_loop_filter = AVDISCARD_NONREF;
+            break;
+        case DecodeQuality::PREVIEW:
+            c->flags2 |= AV_CODEC_FLAG2_FAST;
+            c->skip_loop_filter = AVDISCARD_ALL;
+            c->skip_idct = AVDISCARD_NONREF;
+            lowres = 1;
+            break;
+        case DecodeQuality::PROXY:
+            c->flags2 |= AV_CODEC_FLAG2_FAST;
+            c->skip_loop_filter = AVDISCARD_ALL;
+            c->skip_idct = AVDISCARD_BIDIR;
+            lowres = 2;
+            break;
+    }
+    //只有mjpeg、mpeg4等少数解码器支持lowres，h264/hevc的max_lowres为0
+    if (!opened && codec) {
+        c->lowres = std::min(lowres, (int)codec->max_lowres);
+    }
+}
+
+inline void BaseDecoder::attachFramePool(){
+    frame_pool_.reset();
+    if (!frame_pool_config_.enabled) {
+        return;
+    }
+    frame_pool_.reset(new DecoderFramePool(frame_pool_config_));
+    if (!frame_pool_->attach(c)) {
+        frame_pool_.reset();
+    }
+}
+
+inline int BaseDecoder::receiveFrames(const FrameCallback& on_frame){
+    size_t count = 0;
+    int ret = 0;
+    while (true) {
+        if (count == frame_batch_.size()) {
+            AVFrame* f = av_frame_alloc();
+            if (!f) {
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+            frame_batch_.push_back(f);
+        }
+        ret = avcodec_receive_frame(c, frame_batch_[count]);
+        if (ret < 0) {
+            break;
+        }
+        count++;
+    }
+
+    bool want_more = true;
+    for (size_t i = 0; i < count; i++) {
+        if (want_more) {
+            want_more = on_frame(frame_batch_[i]);
+        }
+        av_frame_unref(frame_batch_[i]);
+    }
+
+    if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+        fprintf(stderr, "Error during decoding\n");
+        return ret;
+    }
+    return (int)count;
+}
+
+inline int BaseDecoder::decode(AVPacket* pkt, const FrameCallback& on_frame){
+    if (!pkt) {
+        return drain(on_frame);
+    }
+    int delivered = 0;
+    int ret = avcodec_send_packet(c, pkt);
+    if (ret == AVERROR(EAGAIN)) {
+        //输出队列已满，先取走帧再重新送包
+        int n = receiveFrames(on_frame);
+        if (n < 0) return n;
+        delivered += n;
+        ret = avcodec_send_packet(c, pkt);
+    }
+    if (ret < 0) {
+        fprintf(stderr, "Error sending packet for decoding\n");
+        return ret;
+    }
+    int n = receiveFrames(on_frame);
+    if (n < 0) return n;
+    return delivered + n;
+}
+
+inline int BaseDecoder::drain(const FrameCallback& on_frame){
+    int ret = avcodec_send_packet(c, nullptr);
+    if (ret < 0 && ret != AVERROR_EOF) {
+        fprintf(stderr, "Error sending flush packet for decoding\n");
+        return ret;
+    }
+    int n = receiveFrames(on_frame);
+    avcodec_flush_buffers(c);
+    return n;
+}
 
 inline BaseDecoder::BaseDecoder(): codec(nullptr),c(nullptr),parser(nullptr),decoded_frame(nullptr),isinit(false) {}
 inline BaseDecoder::~BaseDecoder() {
     avcodec_free_context(&c);
     av_parser_close(parser);
     av_frame_free(&decoded_frame);
+    avcodec_parameters_free(&init_params_);
+    for (AVFrame*& f : frame_batch_) {
+        av_frame_free(&f);
+    }
 }
 
  #endif
\ No newline at end of file
@@ -1,5 +1,22 @@
 #ifndef DEMUXER
 #define DEMUXER
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+#include <memory>
+#include <string>
+#include <functional>
+#include "KeyframeIndex.hpp"
+#include "AVIOReader.hpp"
+#include "StreamInfoCache.hpp"
+#include "PacketPool.hpp"
+#include <chrono>
 extern "C"{
     #include <libavutil/imgutils.h>
     #include <libavutil/samplefmt.h>
@@ -8,6 +25,30 @@ extern "C"{
     #include <libavformat/avformat.h>
 }
 
+//后台预读配置，水位按单个流计算
+struct PrefetchConfig{
+    bool enabled = false;
+    size_t high_packets = 256;          // 达到后读线程挂起
+    size_t low_packets = 128;           // 低于后读线程恢复
+    size_t high_bytes = 64 * 1024 * 1024;
+    size_t low_bytes = 32 * 1024 * 1024;
+};
+
+//快速打开：限制探测量，并可通过StreamInfoCache跳过探测
+struct ProbeOptions{
+    bool fast = false;
+    int64_t probesize = 32 * 1024;          // 字节
+    int64_t analyzeduration = 500 * 1000;   // 微秒
+    bool use_cache = false;
+    bool log_stats = false;             // 首个包交付时打印OpenStats，否则只能通过getOpenStats读取
+};
+
+struct OpenStats{
+    double open_ms = 0.0;                 // avformat_open_input
+    double probe_ms = 0.0;                // avformat_find_stream_info，命中缓存为0
+    bool cache_hit = false;
+    double time_to_first_packet_ms = -1.0; // 从loadfile开始到首个包交付
+};
 
 class Demuxer{
     public:
@@ -15,22 +56,96 @@ class Demuxer{
         ~Demuxer();
 
         bool loadfile(const char* src_filename);
+        //从调用方内存解封装，data需在Demuxer关闭前保持有效
+        bool loadmemory(const uint8_t* data,size_t size,size_t buffer_size = 0);
+        //buffer_size为0时使用后端默认值
+        void setIOBackend(IOBackend backend,size_t buffer_size = 0);
+        void setProbeOptions(const ProbeOptions& options) { probe_options_ = options; }
+        const OpenStats& getOpenStats() const { return open_stats_; }
         bool open_video_format();
         bool open_audio_format();
-        
+
         AVFormatContext* get_fmx() const;
         AVStream* get_audiostream() const;
         AVStream* get_videostream() const;
         int stream_init(enum AVMediaType type) ;
         int getVideoStreamIndex() const;
         int getAudioStreamIndex() const;
-        
-    private:    
+
+        //全部流，包括多音轨、字幕和数据流
+        int getStreamCount() const;
+        AVStream* getStream(int index) const;
+        std::vector<int> getStreamIndices(AVMediaType type) const;
+        //被选中的流才会进入预读队列；applyStreamDiscard对其余流设置AVDISCARD_ALL
+        bool selectStream(int index);
+        void unselectStream(int index);
+        bool isStreamSelected(int index) const { return selected_streams_.count(index) > 0; }
+        void applyStreamDiscard();
+
+        void setPrefetchConfig(const PrefetchConfig& config) { prefetch_config_ = config; }
+        bool startPrefetch();
+        void stopPrefetch();
+        bool isPrefetching() const { return prefetch_thread_ != nullptr; }
+        //与av_read_frame语义一致：成功返回0，结束返回AVERROR_EOF
+        int readPacket(AVPacket* pkt);
+
+        //打开文件时加载或建立关键帧索引
+        void setKeyframeIndexEnabled(bool enable) { index_enabled_ = enable; }
+        bool buildKeyframeIndex();
+        const KeyframeIndex& getKeyframeIndex() const { return keyframe_index_; }
+        //时间单位均为AV_TIME_BASE，定位到不晚于目标的关键帧
+        bool seekTo(int64_t timestamp);
+        //从start之前的关键帧开始交付，直到参考流的dts到达end；回调返回false提前结束
+        int readRange(int64_t start,int64_t end,const std::function<bool(AVPacket*)>& on_packet);
+
+    private:
+        struct StreamQueue{
+            std::deque<std::pair<uint64_t,AVPacket*>> packets;
+            size_t bytes = 0;
+        };
+
+        void prefetchLoop();
+        bool queueAboveHigh(const StreamQueue& q) const;
+        bool queueBelowLow(const StreamQueue& q) const;
+        void clearQueues();
+        int referenceStreamIndex() const;
+        bool openInput(const char* url);
+        //停止预读并关闭当前输入；fmt_ctx->pb可能指向io_reader_的AVIOContext，须先于读取器释放
+        void closeInput();
+        bool probeStreams();
+        int readPacketInternal(AVPacket* pkt);
+        void markFirstPacket();
+        bool loadOrBuildIndex();
+
         AVFormatContext *fmt_ctx = NULL;
+        IOBackend io_backend_ = IOBackend::DEFAULT;
+        size_t io_buffer_size_ = 0;
+        std::unique_ptr<AVIOReader> io_reader_;
+        ProbeOptions probe_options_;
+        OpenStats open_stats_;
+        std::chrono::steady_clock::time_point open_start_;
+        bool first_packet_seen_ = false;
         AVStream *video_stream;
         AVStream *audio_stream;
         int video_stream_idx;
         int audio_stream_idx;
+        std::set<int> selected_streams_;
+
+        PrefetchConfig prefetch_config_;
+        std::unique_ptr<std::thread> prefetch_thread_;
+        std::atomic<bool> prefetch_stop_;
+        std::map<int,StreamQueue> queues_;
+        std::mutex queue_mutex_;
+        std::condition_variable data_cv_;
+        std::condition_variable space_cv_;
+        uint64_t packet_seq_ = 0;
+        bool reader_eof_ = false;
+        int reader_error_ = 0;
+
+        std::string src_filename_;
+        bool index_enabled_ = false;
+        bool rewind_failed_ = false;    // 建索引扫描后未能回到文件头，读位置不可用
+        KeyframeIndex keyframe_index_;
 };
 
-#endif
\ No newline at end of file
+#endif
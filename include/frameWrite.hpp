@@ -6,6 +6,7 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include <vector>
 extern "C"{
     #include <libavutil/frame.h>
     #include <libavcodec/avcodec.h>
@@ -56,6 +57,7 @@ private:
     int bytesPerSample_ = 0;
     int channels_ = 0;
     int sampleRate_ = 0;
+    std::vector<uint8_t> interleaved_;     // planar帧交错后的暂存
 };
 
 class YUVFrameWriter : public FrameWriter {
@@ -72,9 +74,9 @@ private:
     FILE* outFile = nullptr;
     int frameindex;
 
-    //缓冲区相关
-    uint8_t* video_dst_data[4] = {nullptr};
-    int video_dst_linesize[4] = {0};
+    //各平面有效字节宽度与行数，直接从帧写出，不再拷贝到中间缓冲
+    int plane_width[4] = {0};
+    int plane_height[4] = {0};
     int video_dst_bufsize = 0;
     int width = 0;
     int height = 0;
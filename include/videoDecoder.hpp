@@ -1,3 +1,6 @@
+#ifndef VIDEODECODER_HPP
+#define VIDEODECODER_HPP
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
@@ -24,3 +27,4 @@
         AVPixelFormat getPixFmt() const;
  };
 
+#endif
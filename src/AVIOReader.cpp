@@ -0,0 +1,179 @@
+#include "AVIOReader.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+AVIOReader::AVIOReader(size_t buffer_size)
+    : buffer_size_(buffer_size) {
+}
+
+AVIOReader::~AVIOReader(){
+    if(avio_ctx_){
+        //avio可能替换过内部缓冲区，必须释放ctx当前持有的那一块
+        av_freep(&avio_ctx_->buffer);
+        avio_context_free(&avio_ctx_);
+    }
+}
+
+AVIOContext* AVIOReader::getContext(){
+    if(avio_ctx_){
+        return avio_ctx_;
+    }
+    uint8_t* buffer = (uint8_t*)av_malloc(buffer_size_);
+    if(!buffer){
+        fprintf(stderr,"Could not allocate avio buffer\n");
+        return nullptr;
+    }
+    avio_ctx_ = avio_alloc_context(buffer,(int)buffer_size_,0,this,
+                                   &AVIOReader::readCallback,nullptr,
+                                   seekable() ? &AVIOReader::seekCallback : nullptr);
+    if(!avio_ctx_){
+        av_free(buffer);
+        fprintf(stderr,"Could not allocate avio context\n");
+        return nullptr;
+    }
+    avio_ctx_->seekable = seekable() ? AVIO_SEEKABLE_NORMAL : 0;
+    return avio_ctx_;
+}
+
+int AVIOReader::readCallback(void* opaque,uint8_t* buf,int size){
+    return static_cast<AVIOReader*>(opaque)->read(buf,size);
+}
+
+int64_t AVIOReader::seekCallback(void* opaque,int64_t offset,int whence){
+    return static_cast<AVIOReader*>(opaque)->seek(offset,whence);
+}
+
+static int64_t resolve_seek(int64_t offset,int whence,size_t pos,size_t size){
+    switch(whence & ~AVSEEK_FORCE){
+        case AVSEEK_SIZE: return (int64_t)size;
+        case SEEK_SET: break;
+        case SEEK_CUR: offset += (int64_t)pos; break;
+        case SEEK_END: offset += (int64_t)size; break;
+        default: return AVERROR(EINVAL);
+    }
+    if(offset < 0 || offset > (int64_t)size){
+        return AVERROR(EINVAL);
+    }
+    return offset;
+}
+
+MmapReader::MmapReader(const std::string& path,size_t buffer_size)
+    : AVIOReader(buffer_size), path_(path) {
+}
+
+MmapReader::~MmapReader(){
+    if(data_){
+        munmap(data_,size_);
+    }
+    if(fd_ >= 0){
+        ::close(fd_);
+    }
+}
+
+bool MmapReader::open(){
+    fd_ = ::open(path_.c_str(),O_RDONLY);
+    if(fd_ < 0){
+        fprintf(stderr,"could not open source file %s\n",path_.c_str());
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd_,&st) < 0 || st.st_size <= 0){
+        fprintf(stderr,"could not stat source file %s\n",path_.c_str());
+        return false;
+    }
+    size_ = (size_t)st.st_size;
+    void* p = mmap(nullptr,size_,PROT_READ,MAP_PRIVATE,fd_,0);
+    if(p == MAP_FAILED){
+        fprintf(stderr,"could not mmap source file %s: %s\n",path_.c_str(),strerror(errno));
+        size_ = 0;
+        return false;
+    }
+    data_ = (uint8_t*)p;
+    madvise(data_,size_,MADV_SEQUENTIAL);
+    return true;
+}
+
+int MmapReader::read(uint8_t* buf,int size){
+    if(pos_ >= size_){
+        return AVERROR_EOF;
+    }
+    size_t n = std::min((size_t)size,size_ - pos_);
+    memcpy(buf,data_ + pos_,n);
+    pos_ += n;
+    return (int)n;
+}
+
+int64_t MmapReader::seek(int64_t offset,int whence){
+    int64_t ret = resolve_seek(offset,whence,pos_,size_);
+    if(ret >= 0 && (whence & ~AVSEEK_FORCE) != AVSEEK_SIZE){
+        pos_ = (size_t)ret;
+    }
+    return ret;
+}
+
+MemoryReader::MemoryReader(const uint8_t* data,size_t size,size_t buffer_size)
+    : AVIOReader(buffer_size), data_(data), size_(size) {
+}
+
+int MemoryReader::read(uint8_t* buf,int size){
+    if(pos_ >= size_){
+        return AVERROR_EOF;
+    }
+    size_t n = std::min((size_t)size,size_ - pos_);
+    memcpy(buf,data_ + pos_,n);
+    pos_ += n;
+    return (int)n;
+}
+
+int64_t MemoryReader::seek(int64_t offset,int whence){
+    int64_t ret = resolve_seek(offset,whence,pos_,size_);
+    if(ret >= 0 && (whence & ~AVSEEK_FORCE) != AVSEEK_SIZE){
+        pos_ = (size_t)ret;
+    }
+    return ret;
+}
+
+PipeReader::PipeReader(int fd,size_t buffer_size,bool owns_fd)
+    : AVIOReader(buffer_size), fd_(fd), owns_fd_(owns_fd) {
+}
+
+PipeReader::~PipeReader(){
+    if(owns_fd_ && fd_ >= 0){
+        ::close(fd_);
+    }
+}
+
+int PipeReader::read(uint8_t* buf,int size){
+    ssize_t n;
+    do{
+        n = ::read(fd_,buf,size);
+    }while(n < 0 && errno == EINTR);
+    if(n < 0){
+        return AVERROR(errno);
+    }
+    return n == 0 ? AVERROR_EOF : (int)n;
+}
+
+std::unique_ptr<AVIOReader> AVIOReaderFactory::createReader(const std::string& path,IOBackend backend,size_t buffer_size){
+    if(path == "-" || path == "pipe:" || backend == IOBackend::PIPE){
+        bool is_stdin = (path == "-" || path == "pipe:");
+        int fd = is_stdin ? STDIN_FILENO : ::open(path.c_str(),O_RDONLY);
+        if(fd < 0){
+            fprintf(stderr,"could not open source file %s\n",path.c_str());
+            return nullptr;
+        }
+        return std::make_unique<PipeReader>(fd,buffer_size ? buffer_size : 256 * 1024,!is_stdin);
+    }
+    if(backend == IOBackend::MMAP){
+        return buffer_size ? std::make_unique<MmapReader>(path,buffer_size)
+                           : std::make_unique<MmapReader>(path);
+    }
+    //MEMORY由调用方通过Demuxer::loadmemory提供数据
+    return nullptr;
+}
@@ -197,14 +197,14 @@ int AudioEncoder::encode(AVFrame* encode_frame){
        return ret ;
     }
     while(ret >=0){
-        AVPacket* pkt = av_packet_alloc();
+        AVPacket* pkt = PacketPool::instance().acquire();
         ret = avcodec_receive_packet(c, pkt);
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            av_packet_free(&pkt);
+            PacketPool::instance().release(pkt);
             break;  
         } else if (ret < 0) {
             fprintf(stderr, "Error receiving packet\n");
-            av_packet_free(&pkt);
+            PacketPool::instance().release(pkt);
             exit(1);
         }
         //本地播放aac添加adts头
@@ -76,6 +76,39 @@ int AVMuxer::addAudioStream(AVCodecParameters* codecpar){
     return st->index;
 }
 
+int AVMuxer::addStreamCopy(const AVStream* in_stream){
+    if(!oc || !in_stream){
+        return -1;
+    }
+    AVCodecID codec_id = in_stream->codecpar->codec_id;
+    if(avformat_query_codec(oc->oformat,codec_id,FF_COMPLIANCE_NORMAL) == 0){
+        fprintf(stderr,"Codec %s cannot be stream-copied into %s\n",
+                avcodec_get_name(codec_id),oc->oformat->name);
+        return -1;
+    }
+
+    AVStream* st = avformat_new_stream(oc,nullptr);
+    if(!st){
+        fprintf(stderr,"Could not allocate output stream\n");
+        return -1;
+    }
+    st->id = oc->nb_streams - 1;
+    if(avcodec_parameters_copy(st->codecpar,in_stream->codecpar) < 0){
+        fprintf(stderr,"Could not copy codec parameters\n");
+        return -1;
+    }
+    //源容器的codec_tag在目标容器中不一定合法，交给muxer重新选择
+    st->codecpar->codec_tag = 0;
+    st->time_base = in_stream->time_base;
+    st->sample_aspect_ratio = in_stream->sample_aspect_ratio;
+
+    StreamInfo info;
+    info.st = st;
+    info.index = st->index;
+    stream_.push_back(info);
+    return st->index;
+}
+
 int AVMuxer::writePacket(AVPacket* packet,AVRational timeBase) {
     if (!oc || !packet) {
         return 0;
@@ -94,7 +127,9 @@ int AVMuxer::writePacket(AVPacket* packet,AVRational timeBase) {
     if(stream_publisher_){
         stream_publisher_->onPacketSent(packet->size);
     }
-    log_packet(packet);
+    if(log_packets_){
+        log_packet(packet);
+    }
     int ret = av_interleaved_write_frame(oc, packet);
     if (ret < 0) {
         fprintf(stderr, "Error while writing output packet\n");
@@ -0,0 +1,229 @@
+#include "BatchDecodeService.hpp"
+#include "demuxer.hpp"
+#include "frameWrite.hpp"
+#include <cstdio>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+BatchDecodeService::BatchDecodeService(const Config& config):config_(config){
+    int cores = (int)std::max(1u,std::thread::hardware_concurrency());
+    if(config_.workers <= 0){
+        config_.workers = cores;
+    }
+    //每个worker只分到自己那份核，避免worker数×解码线程数远超核数
+    worker_threads_ = config_.thread_config;
+    if(worker_threads_.auto_tune && worker_threads_.max_threads <= 0){
+        worker_threads_.max_threads = std::max(1,cores / config_.workers);
+    }
+}
+
+bool BatchDecodeService::loadManifest(const std::string& path,std::vector<BatchItem>& items,
+                                      const std::string& default_output_dir){
+    std::ifstream in(path);
+    if(!in){
+        fprintf(stderr,"could not open manifest %s\n",path.c_str());
+        return false;
+    }
+    std::string line;
+    while(std::getline(in,line)){
+        if(!line.empty() && line.back() == '\r'){
+            line.pop_back();
+        }
+        if(line.empty() || line[0] == '#'){
+            continue;
+        }
+        BatchItem item;
+        size_t tab = line.find('\t');
+        if(tab == std::string::npos){
+            item.input = line;
+            item.output_dir = default_output_dir;
+        }else{
+            item.input = line.substr(0,tab);
+            item.output_dir = line.substr(tab + 1);
+        }
+        items.push_back(item);
+    }
+    return true;
+}
+
+bool BatchDecodeService::prepareDecoder(BaseDecoder* decoder,AVCodecParameters* codecpar,bool& reused){
+    reused = decoder->reuseForStream(codecpar);
+    if(reused){
+        return true;
+    }
+    decoder->setThreadConfig(worker_threads_);
+    return decoder->initialize_fromstream(codecpar);
+}
+
+bool BatchDecodeService::decodeOne(Worker& worker,const BatchItem& item,BatchFileStats& stats){
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    uint64_t size = fs::file_size(item.input,ec);
+    stats.bytes_in = ec ? 0 : size;
+
+    Demuxer demuxer;
+    if(!demuxer.loadfile(item.input.c_str())){
+        return false;
+    }
+
+    BaseDecoder* video = nullptr;
+    BaseDecoder* audio = nullptr;
+    if(!demuxer.getStreamIndices(AVMEDIA_TYPE_VIDEO).empty() && demuxer.open_video_format()){
+        if(!worker.video){
+            worker.video.reset(new videoDecoder());
+        }
+        worker.video->setDecodeQuality(config_.quality);
+        if(prepareDecoder(worker.video.get(),demuxer.get_videostream()->codecpar,stats.video_reused)){
+            video = worker.video.get();
+        }
+    }
+    if(config_.decode_audio && !demuxer.getStreamIndices(AVMEDIA_TYPE_AUDIO).empty() && demuxer.open_audio_format()){
+        if(!worker.audio){
+            worker.audio.reset(new AudioDecoder());
+        }
+        if(prepareDecoder(worker.audio.get(),demuxer.get_audiostream()->codecpar,stats.audio_reused)){
+            audio = worker.audio.get();
+        }
+    }
+    if(!video && !audio){
+        fprintf(stderr,"No decodable stream in %s\n",item.input.c_str());
+        return false;
+    }
+    if(!video){
+        demuxer.unselectStream(demuxer.getVideoStreamIndex());
+    }
+    if(!audio){
+        demuxer.unselectStream(demuxer.getAudioStreamIndex());
+    }
+    demuxer.applyStreamDiscard();
+
+    std::unique_ptr<FrameWriter> video_writer;
+    std::unique_ptr<FrameWriter> audio_writer;
+    if(!item.output_dir.empty()){
+        fs::create_directories(item.output_dir,ec);
+        std::string stem = fs::path(item.input).stem().string();
+        if(video){
+            video_writer = FrameWriterFactory::createWriter((fs::path(item.output_dir) / (stem + ".yuv")).string(),MediaType::VIDEO);
+            video_writer->open();
+        }
+        if(audio){
+            audio_writer = FrameWriterFactory::createWriter((fs::path(item.output_dir) / (stem + ".pcm")).string(),MediaType::AUDIO);
+            audio_writer->open();
+        }
+    }
+
+    auto on_video = [&](AVFrame* frame){
+        stats.video_frames++;
+        if(video_writer){
+            video_writer->writeFrame(frame);
+        }
+        return true;
+    };
+    auto on_audio = [&](AVFrame* frame){
+        stats.audio_frames++;
+        if(audio_writer){
+            audio_writer->writeFrame(frame);
+        }
+        return true;
+    };
+
+    int video_idx = video ? demuxer.getVideoStreamIndex() : -1;
+    int audio_idx = audio ? demuxer.getAudioStreamIndex() : -1;
+    bool ok = true;
+    AVPacket* pkt = PacketPool::instance().acquire();
+    int ret;
+    while((ret = demuxer.readPacket(pkt)) >= 0){
+        int n = 0;
+        if(pkt->stream_index == video_idx){
+            n = video->decode(pkt,on_video);
+        }else if(pkt->stream_index == audio_idx){
+            n = audio->decode(pkt,on_audio);
+        }
+        av_packet_unref(pkt);
+        if(n < 0){
+            ok = false;
+            break;
+        }
+    }
+    PacketPool::instance().release(pkt);
+    if(ret < 0 && ret != AVERROR_EOF){
+        ok = false;
+    }
+    //drain同时清空解码器状态，下一个文件可直接复用
+    if(video){
+        video->drain(on_video);
+    }
+    if(audio){
+        audio->drain(on_audio);
+    }
+    if(video_writer){
+        video_writer->close();
+    }
+    if(audio_writer){
+        audio_writer->close();
+    }
+    return ok;
+}
+
+BatchStats BatchDecodeService::run(const std::vector<BatchItem>& items,std::vector<BatchFileStats>* per_file){
+    BatchStats total;
+    std::vector<BatchFileStats> results(items.size());
+    std::atomic<size_t> next(0);
+    std::mutex report_mutex;
+    int workers = std::min<int>(config_.workers,std::max<size_t>(1,items.size()));
+
+    auto start = std::chrono::steady_clock::now();
+    auto worker_loop = [&](int id){
+        Worker worker;
+        size_t i;
+        while((i = next.fetch_add(1)) < items.size()){
+            BatchFileStats& stats = results[i];
+            stats.input = items[i].input;
+            stats.worker = id;
+            auto t0 = std::chrono::steady_clock::now();
+            stats.ok = decodeOne(worker,items[i],stats);
+            stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            if(config_.report){
+                std::lock_guard<std::mutex> lock(report_mutex);
+                printf("[batch %zu/%zu] %s %s: %lld frames, %.1f fps, %.2f MB/s%s\n",
+                       i + 1,items.size(),stats.ok ? "ok" : "FAILED",stats.input.c_str(),
+                       (long long)(stats.video_frames + stats.audio_frames),
+                       stats.framesPerSecond(),stats.megabytesPerSecond(),
+                       (stats.video_reused || stats.audio_reused) ? " (reused)" : "");
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(int w = 0; w < workers; w++){
+        threads.emplace_back(worker_loop,w);
+    }
+    for(auto& t : threads){
+        t.join();
+    }
+    total.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for(const BatchFileStats& stats : results){
+        total.files++;
+        if(!stats.ok){
+            total.failed++;
+        }
+        total.frames += stats.video_frames + stats.audio_frames;
+        total.bytes_in += stats.bytes_in;
+        total.reused_contexts += (stats.video_reused ? 1 : 0) + (stats.audio_reused ? 1 : 0);
+    }
+    if(config_.report){
+        printf("[batch] %d files (%d failed) on %d workers in %.2fs: %.1f fps, %.2f MB/s, %d decoder contexts reused\n",
+               total.files,total.failed,workers,total.wall_seconds,
+               total.framesPerSecond(),total.megabytesPerSecond(),total.reused_contexts);
+    }
+    if(per_file){
+        *per_file = std::move(results);
+    }
+    return total;
+}
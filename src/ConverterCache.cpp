@@ -0,0 +1,166 @@
+#include "ConverterCache.hpp"
+#include <cstdio>
+extern "C"{
+    #include <libavutil/opt.h>
+}
+
+ConverterCache& ConverterCache::instance(){
+    static ConverterCache cache;
+    return cache;
+}
+
+ConverterCache::~ConverterCache(){
+    clear();
+}
+
+SwsContext* ConverterCache::createVideo(const VideoConverterKey& key){
+#ifdef SWS_HAS_THREADS
+    if(key.threads > 1){
+        SwsContext* ctx = sws_alloc_context();
+        if(!ctx){
+            return nullptr;
+        }
+        av_opt_set_int(ctx,"srcw",key.src_width,0);
+        av_opt_set_int(ctx,"srch",key.src_height,0);
+        av_opt_set_int(ctx,"src_format",key.src_format,0);
+        av_opt_set_int(ctx,"dstw",key.dst_width,0);
+        av_opt_set_int(ctx,"dsth",key.dst_height,0);
+        av_opt_set_int(ctx,"dst_format",key.dst_format,0);
+        av_opt_set_int(ctx,"sws_flags",key.flags,0);
+        av_opt_set_int(ctx,"threads",key.threads,0);
+        if(sws_init_context(ctx,nullptr,nullptr) < 0){
+            sws_freeContext(ctx);
+            return nullptr;
+        }
+        return ctx;
+    }
+#endif
+    return sws_getContext(key.src_width,key.src_height,key.src_format,
+                          key.dst_width,key.dst_height,key.dst_format,
+                          key.flags,nullptr,nullptr,nullptr);
+}
+
+SwrContext* ConverterCache::createAudio(const AudioConverterKey& key){
+    SwrContext* ctx = swr_alloc();
+    if(!ctx){
+        return nullptr;
+    }
+    av_opt_set_chlayout(ctx,"in_chlayout",&key.src_layout,0);
+    av_opt_set_int(ctx,"in_sample_rate",key.src_sample_rate,0);
+    av_opt_set_sample_fmt(ctx,"in_sample_fmt",key.src_format,0);
+    av_opt_set_chlayout(ctx,"out_chlayout",&key.dst_layout,0);
+    av_opt_set_int(ctx,"out_sample_rate",key.dst_sample_rate,0);
+    av_opt_set_sample_fmt(ctx,"out_sample_fmt",key.dst_format,0);
+    if(swr_init(ctx) < 0){
+        swr_free(&ctx);
+        return nullptr;
+    }
+    return ctx;
+}
+
+SwsContext* ConverterCache::acquireVideo(const VideoConverterKey& key){
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(auto it = idle_video_.begin(); it != idle_video_.end(); ++it){
+            if(it->key == key){
+                SwsContext* ctx = it->ctx;
+                idle_video_.erase(it);
+                hits_++;
+                return ctx;
+            }
+        }
+    }
+    misses_++;
+    SwsContext* ctx = createVideo(key);
+    if(!ctx){
+        fprintf(stderr,"can not create convert %dx%d %d -> %dx%d %d\n",
+                key.src_width,key.src_height,key.src_format,key.dst_width,key.dst_height,key.dst_format);
+    }
+    return ctx;
+}
+
+void ConverterCache::releaseVideo(const VideoConverterKey& key,SwsContext*& ctx){
+    if(!ctx){
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_video_.push_front({key,ctx});
+    ctx = nullptr;
+    trimLocked();
+}
+
+SwrContext* ConverterCache::acquireAudio(const AudioConverterKey& key){
+    if(key.cacheable()){
+        std::lock_guard<std::mutex> lock(mutex_);
+        for(auto it = idle_audio_.begin(); it != idle_audio_.end(); ++it){
+            if(it->key == key){
+                SwrContext* ctx = it->ctx;
+                idle_audio_.erase(it);
+                hits_++;
+                return ctx;
+            }
+        }
+    }
+    misses_++;
+    SwrContext* ctx = createAudio(key);
+    if(!ctx){
+        fprintf(stderr,"无法初始化音频重采样器\n");
+    }
+    return ctx;
+}
+
+void ConverterCache::releaseAudio(const AudioConverterKey& key,SwrContext*& ctx){
+    if(!ctx){
+        return;
+    }
+    //swr_init会先清掉内部状态再按原参数初始化
+    if(!key.cacheable() || swr_init(ctx) < 0){
+        swr_free(&ctx);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    //非自定义布局不持有额外内存，键可以按值保存
+    idle_audio_.push_front({key,ctx});
+    ctx = nullptr;
+    trimLocked();
+}
+
+void ConverterCache::trimLocked(){
+    while(idle_video_.size() + idle_audio_.size() > max_idle_){
+        //两类里各自最久未用的在表尾，优先释放较长的那一类
+        if(idle_video_.size() >= idle_audio_.size()){
+            sws_freeContext(idle_video_.back().ctx);
+            idle_video_.pop_back();
+        }else{
+            swr_free(&idle_audio_.back().ctx);
+            idle_audio_.pop_back();
+        }
+    }
+}
+
+void ConverterCache::setMaxIdle(size_t max_idle){
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_idle_ = max_idle;
+    trimLocked();
+}
+
+ConverterCache::Stats ConverterCache::getStats() const{
+    Stats stats;
+    stats.hits = hits_.load();
+    stats.misses = misses_.load();
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.idle = idle_video_.size() + idle_audio_.size();
+    return stats;
+}
+
+void ConverterCache::clear(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(VideoEntry& e : idle_video_){
+        sws_freeContext(e.ctx);
+    }
+    for(AudioEntry& e : idle_audio_){
+        swr_free(&e.ctx);
+    }
+    idle_video_.clear();
+    idle_audio_.clear();
+}
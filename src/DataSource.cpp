@@ -1,4 +1,5 @@
 #include "DataSource.hpp"
+#include "SampleInterleave.hpp"
 
 RawFileDataSource::RawFileDataSource(const std::string& file_path, FileType type)
     : file_path_(file_path), file_type_(type)
@@ -80,41 +81,45 @@ void RawFileDataSource::readPCMLoop(){
     std::vector<uint8_t> temp_buffer(frame_size);
     std::streamsize bytes_read;
 
+    //源帧和转换输出帧在循环外分配一次，之后每帧只覆盖数据
+    AVFrame* source_frame = av_frame_alloc();
+    AVFrame* converted_frame = av_frame_alloc();
+    if (!source_frame || !converted_frame) {
+        av_frame_free(&source_frame);
+        av_frame_free(&converted_frame);
+        return;
+    }
+    source_frame->sample_rate = pcm_sample_rate_;
+    source_frame->format = pcm_format_;
+    source_frame->nb_samples = pcm_samples_per_frame_;
+    av_channel_layout_default(&source_frame->ch_layout, pcm_channels_);
+    if (av_frame_get_buffer(source_frame, 0) < 0) {
+        fprintf(stderr, "could not allocate pcm frame\n");
+        av_frame_free(&source_frame);
+        av_frame_free(&converted_frame);
+        return;
+    }
+
     while(is_active_ && !file_stream_.eof()){
         file_stream_.read(reinterpret_cast<char*>(temp_buffer.data()), frame_size);
         bytes_read = file_stream_.gcount();
         int samples_read = bytes_read /(pcm_channels_ * pcm_bytes_per_sample_);
-        if(bytes_read >0){
-            AVFrame* source_frame = av_frame_alloc();
-            source_frame->sample_rate = pcm_sample_rate_;
-            source_frame->format = pcm_format_;
+        if(samples_read >0){
             source_frame->nb_samples = samples_read;
-            AVChannelLayout ch_layout;
-            av_channel_layout_default(&ch_layout, pcm_channels_);
-            av_channel_layout_copy(&source_frame->ch_layout, &ch_layout);
-            int ret = av_frame_get_buffer(source_frame, 0);
-            if (ret < 0) {
-                av_frame_free(&source_frame);
-                continue;
-            }
             fill_frame_from_pcm(source_frame,temp_buffer.data(),samples_read,bytes_read);
-            AVFrame* final_frame;
-            if (format_converter_ && format_converter_->needAudioConversion()) {
-                final_frame = format_converter_->convertAudio(source_frame);
-                av_frame_free(&source_frame);
+            if (format_converter_ && format_converter_->needAudioConversion(source_frame)) {
+                if (format_converter_->convertAudioInto(source_frame, converted_frame)) {
+                    audioBuffer->addFrame(converted_frame);
+                }
             }else{
-                final_frame = source_frame;
+                audioBuffer->addFrame(source_frame);
             }
-            if (final_frame) {
-                audioBuffer->addFrame(final_frame);
-            }
-
-            av_frame_free(&final_frame);
-            av_channel_layout_uninit(&ch_layout);
         }
         double frame_duration_sec = static_cast<double>(samples_read) / pcm_sample_rate_;
         std::this_thread::sleep_for(std::chrono::duration<double>(frame_duration_sec));
     }
+    av_frame_free(&source_frame);
+    av_frame_free(&converted_frame);
 }
 
 
@@ -123,43 +128,54 @@ void RawFileDataSource::readYUVLoop(){
         return;
     }
     VideoFrameBuffer* videoBuffer = data_manager_->getVideoBuffer();
-    std::vector<uint8_t> frame_buffer(yuv_frame_size_);
+
+    //源帧直接指向读缓冲，转换输出帧复用同一块池缓冲；缓冲区addFrame时会拷贝
+    //读缓冲做成AVBufferRef，多线程转换时不会被整帧拷贝
+    AVFrame* source_frame = av_frame_alloc();
+    AVFrame* converted_frame = av_frame_alloc();
+    if (source_frame) {
+        source_frame->buf[0] = av_buffer_alloc(yuv_frame_size_);
+    }
+    if (!source_frame || !source_frame->buf[0] || !converted_frame) {
+        av_frame_free(&source_frame);
+        av_frame_free(&converted_frame);
+        return;
+    }
+    uint8_t* frame_buffer = source_frame->buf[0]->data;
+    source_frame->format =yuv_format_;
+    source_frame->width = yuv_width_;
+    source_frame->height = yuv_height_;
+    av_image_fill_arrays(source_frame->data, source_frame->linesize,
+                           frame_buffer, yuv_format_,
+                           yuv_width_, yuv_height_, 1);
 
     while (is_active_ && !file_stream_.eof())
     {
-        file_stream_.read(reinterpret_cast<char*>(frame_buffer.data()), yuv_frame_size_);
+        file_stream_.read(reinterpret_cast<char*>(frame_buffer), yuv_frame_size_);
         std::streamsize bytes_read = file_stream_.gcount();
         if (bytes_read == static_cast<std::streamsize>(yuv_frame_size_)) {
-                AVFrame* source_frame = av_frame_alloc();
-                source_frame->format =yuv_format_;
-                source_frame->width = yuv_width_;
-                source_frame->height = yuv_height_;
-                av_image_fill_arrays(source_frame->data, source_frame->linesize,
-                                       frame_buffer.data(), yuv_format_,
-                                       yuv_width_, yuv_height_, 1);
-                AVFrame* final_frame = av_frame_clone(source_frame);
-                if (format_converter_ && format_converter_->needVideoConversion()) {
-                    final_frame = format_converter_->convertVideo(source_frame);
+                if (format_converter_ && format_converter_->needVideoConversion(source_frame)) {
+                    if (format_converter_->convertVideoInto(source_frame, converted_frame)) {
+                        videoBuffer->addFrame(converted_frame);
+                    }
+                } else {
+                    videoBuffer->addFrame(source_frame);
                 }
-                videoBuffer->addFrame(final_frame);
-                av_frame_free(&source_frame);
-                av_frame_free(&final_frame);
         } else if (bytes_read > 0) {
             break;
         }
         auto frame_interval = std::chrono::milliseconds(1000 / yuv_fps_);
         std::this_thread::sleep_for(frame_interval);
     }
+    av_frame_free(&source_frame);
+    av_frame_free(&converted_frame);
 }
 
 void RawFileDataSource::fill_frame_from_pcm(AVFrame* frame,uint8_t* pcm_data,int samples_read,std::streamsize bytes_read) 
 {
     if (av_sample_fmt_is_planar(pcm_format_)) {
-        for (int ch = 0; ch < pcm_channels_; ch++) {
-            uint8_t* dst = frame->data[ch];
-            const uint8_t* src = pcm_data + ch * samples_read * pcm_bytes_per_sample_;
-            memcpy(dst, src, samples_read * pcm_bytes_per_sample_);
-        }
+        //文件中的PCM是交错存放的，按样本拆到各声道
+        SampleInterleave::deinterleave(frame->extended_data, pcm_data, pcm_channels_, samples_read, pcm_bytes_per_sample_);
     } else {
         memcpy(frame->data[0], pcm_data, bytes_read);
     }
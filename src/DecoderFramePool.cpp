@@ -0,0 +1,171 @@
+#include "DecoderFramePool.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <sys/mman.h>
+extern "C"{
+    #include <libavutil/imgutils.h>
+    #include <libavutil/pixdesc.h>
+}
+
+static const size_t kPageSize = 4096;
+static const size_t kHugePageSize = 2 * 1024 * 1024;
+
+DecoderFramePool::DecoderFramePool(const FramePoolConfig& config):config_(config){
+    size_t a = config_.alignment;
+    if(a < 16 || a > kPageSize || (a & (a - 1)) != 0){
+        fprintf(stderr,"Invalid frame pool alignment %zu, using 64\n",a);
+        config_.alignment = 64;
+    }
+}
+
+DecoderFramePool::~DecoderFramePool(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    //仍被引用的缓冲在最后一帧释放后由AVBufferPool回收，SizeClass随之释放
+    for(auto& kv : classes_){
+        AVBufferPool* pool = kv.second->pool;
+        av_buffer_pool_uninit(&pool);
+    }
+    classes_.clear();
+}
+
+bool DecoderFramePool::attach(AVCodecContext* ctx){
+    if(!config_.enabled || !ctx || !ctx->codec ||
+       ctx->codec->type != AVMEDIA_TYPE_VIDEO ||
+       !(ctx->codec->capabilities & AV_CODEC_CAP_DR1)){
+        return false;
+    }
+    ctx->opaque = this;
+    ctx->get_buffer2 = &DecoderFramePool::getBuffer2;
+    return true;
+}
+
+size_t DecoderFramePool::getClassCount() const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return classes_.size();
+}
+
+size_t DecoderFramePool::classSize(size_t size) const{
+    size_t granule = (config_.use_hugepages && size >= kHugePageSize) ? kHugePageSize : kPageSize;
+    return (size + granule - 1) / granule * granule;
+}
+
+AVBufferRef* DecoderFramePool::acquire(size_t size){
+    size_t cls = classSize(size);
+    AVBufferPool* pool = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = classes_.find(cls);
+        if(it == classes_.end()){
+            SizeClass* sc = new SizeClass{cls,config_.use_hugepages && cls >= kHugePageSize,nullptr};
+            sc->pool = av_buffer_pool_init2(cls,sc,&DecoderFramePool::allocBuffer,&DecoderFramePool::freeClass);
+            if(!sc->pool){
+                delete sc;
+                return nullptr;
+            }
+            it = classes_.emplace(cls,sc).first;
+        }
+        pool = it->second->pool;
+    }
+    return av_buffer_pool_get(pool);
+}
+
+AVBufferRef* DecoderFramePool::allocBuffer(void* opaque,size_t size){
+    SizeClass* sc = static_cast<SizeClass*>(opaque);
+    void* data = nullptr;
+    if(sc->hugepage){
+#ifdef MAP_HUGETLB
+        data = mmap(nullptr,size,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,-1,0);
+#else
+        data = MAP_FAILED;
+#endif
+        if(data == MAP_FAILED){
+            //未预留大页时退回普通映射，交给透明大页
+            data = mmap(nullptr,size,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+            if(data == MAP_FAILED){
+                return nullptr;
+            }
+#ifdef MADV_HUGEPAGE
+            madvise(data,size,MADV_HUGEPAGE);
+#endif
+        }
+    }else if(posix_memalign(&data,kPageSize,size) != 0){
+        return nullptr;
+    }
+
+    AVBufferRef* buf = av_buffer_create((uint8_t*)data,size,&DecoderFramePool::freeBuffer,sc,0);
+    if(!buf){
+        freeBuffer(sc,(uint8_t*)data);
+    }
+    return buf;
+}
+
+void DecoderFramePool::freeBuffer(void* opaque,uint8_t* data){
+    SizeClass* sc = static_cast<SizeClass*>(opaque);
+    if(sc->hugepage){
+        munmap(data,sc->size);
+    }else{
+        free(data);
+    }
+}
+
+void DecoderFramePool::freeClass(void* opaque){
+    delete static_cast<SizeClass*>(opaque);
+}
+
+int DecoderFramePool::getBuffer2(AVCodecContext* ctx,AVFrame* frame,int flags){
+    DecoderFramePool* self = static_cast<DecoderFramePool*>(ctx->opaque);
+    AVPixelFormat fmt = (AVPixelFormat)frame->format;
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(fmt);
+    if(!self || ctx->codec_type != AVMEDIA_TYPE_VIDEO || !desc ||
+       (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM))){
+        return avcodec_default_get_buffer2(ctx,frame,flags);
+    }
+
+    int w = frame->width;
+    int h = frame->height;
+    int stride_align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2(ctx,&w,&h,stride_align);
+
+    //增大宽度直到所有平面行宽都满足对齐，保持各平面之间的行宽比例
+    int align = (int)self->config_.alignment;
+    int linesize[4];
+    bool unaligned;
+    do{
+        if(av_image_fill_linesizes(linesize,fmt,w) < 0){
+            return avcodec_default_get_buffer2(ctx,frame,flags);
+        }
+        w += w & ~(w - 1);
+        unaligned = false;
+        for(int i = 0; i < 4; i++){
+            int a = stride_align[i] > align ? stride_align[i] : align;
+            if(linesize[i] % a){
+                unaligned = true;
+            }
+        }
+    }while(unaligned);
+
+    ptrdiff_t linesizes[4];
+    size_t sizes[4];
+    for(int i = 0; i < 4; i++){
+        linesizes[i] = linesize[i];
+    }
+    if(av_image_fill_plane_sizes(sizes,fmt,h,linesizes) < 0){
+        return avcodec_default_get_buffer2(ctx,frame,flags);
+    }
+
+    for(int i = 0; i < 4 && sizes[i]; i++){
+        //与libavcodec默认分配器一致，尾部留出SIMD越界读取的余量
+        frame->buf[i] = self->acquire(sizes[i] + 16 + align - 1);
+        if(!frame->buf[i]){
+            for(int j = 0; j < i; j++){
+                av_buffer_unref(&frame->buf[j]);
+                frame->data[j] = nullptr;
+            }
+            return AVERROR(ENOMEM);
+        }
+        frame->data[i] = frame->buf[i]->data;
+        frame->linesize[i] = linesize[i];
+    }
+    frame->extended_data = frame->data;
+    return 0;
+}
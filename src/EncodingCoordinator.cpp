@@ -1,4 +1,8 @@
 #include "EncodingCoordinator.hpp"
+#include <algorithm>
+
+//等待新数据的超时，兼作检查停止标志的周期
+static const int kFrameWaitTimeoutMs = 100;
 
 EncodingCoordinator::EncodingCoordinator() 
     : data_manager_(nullptr)
@@ -69,6 +73,9 @@ void EncodingCoordinator::stop(){
     is_running_ =false;
 
     packet_queue_cv_.notify_all();
+    if(data_manager_){
+        data_manager_->wakeConsumers();
+    }
     if(audio_thread_ && audio_thread_->joinable()){
         audio_thread_->join();
         audio_thread_.reset();
@@ -85,10 +92,19 @@ void EncodingCoordinator::stop(){
     std::lock_guard<std::mutex> lock(packet_queue_mutex_);
     while(!packet_queue_.empty()){
         auto& pair =packet_queue_.front();
-        av_packet_free(&pair.first);
+        PacketPool::instance().release(pair.first);
         packet_queue_.pop();
     }
 
+    PacketPool::Stats pool_stats = PacketPool::instance().getStats();
+    printf("Packet pool: hits=%llu misses=%llu free=%zu\n",
+           (unsigned long long)pool_stats.hits,(unsigned long long)pool_stats.misses,pool_stats.global_free);
+    if(drop_config_.policy != DropPolicy::NONE){
+        FrameDropStats drop_stats = getFrameDropStats();
+        printf("Frame drop: dropped=%llu events=%llu forced_keyframes=%llu max_queue=%zu max_latency=%.1fms\n",
+               (unsigned long long)drop_stats.dropped_frames,(unsigned long long)drop_stats.drop_events,
+               (unsigned long long)drop_stats.forced_keyframes,drop_stats.max_queue_frames,drop_stats.max_latency_ms);
+    }
     printf("Encoding coordinator stopped\n");
 }
 
@@ -101,9 +117,12 @@ void EncodingCoordinator::audioEncodingLoop(){
     int64_t audio_pts = 0;         
     int nb_samples = audio_encoder_->getFrameSize();       
     while(!should_stop_){
+        //数据到达时由生产者唤醒，超时只用于检查停止标志
+        if(!audio_buffer->waitForSamples(audio_pts,nb_samples,kFrameWaitTimeoutMs)){
+            continue;
+        }
         AVFrame* frame = audio_buffer->getAVFrame(audio_pts,nb_samples);
         if(!frame){
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
             continue;
         }
         frame->pts = audio_pts;
@@ -147,13 +166,30 @@ void EncodingCoordinator::videoEncodingLoop(){
         fprintf(stderr,"video buffer not available\n");
         return;
     }
-    int frame_index = 0;
+    int64_t frame_index = 0;
+    bool force_keyframe = false;
     while(!should_stop_){
+        if(!video_buffer->waitForFrame(frame_index,kFrameWaitTimeoutMs)){
+            continue;
+        }
+        if(drop_config_.policy != DropPolicy::NONE){
+            int64_t target = applyDropPolicy(video_buffer,frame_index,force_keyframe);
+            if(target != frame_index){
+                //序号即pts，跳过的帧在时间轴上留下空档，音画同步不受影响
+                frame_index = target;
+                continue;
+            }
+        }
         AVFrame* frame = video_buffer->getAVFrame(frame_index);
         if(!frame){
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
             continue;
         }
+        if(force_keyframe){
+            //帧数据只读，pict_type属于AVFrame本身，可以直接改
+            frame->pict_type = AV_PICTURE_TYPE_I;
+            force_keyframe = false;
+            forced_keyframes_.fetch_add(1,std::memory_order_relaxed);
+        }
         frame->pts = frame_index;
         frame_index++;
         if(video_encoder_->encode(frame)){
@@ -169,6 +205,8 @@ void EncodingCoordinator::videoEncodingLoop(){
                 }
             }
         }
+        //编码器已拷贝或引用了数据，槽位可以交还给生产者
+        video_buffer->releaseFrame(frame);
     }
     if(video_encoder_){
         video_encoder_->flush();
@@ -186,6 +224,77 @@ void EncodingCoordinator::videoEncodingLoop(){
     }
 }
 
+int64_t EncodingCoordinator::applyDropPolicy(VideoFrameBuffer* buffer,int64_t frame_index,bool& force_keyframe){
+    int64_t newest = buffer->getFrameCount() - 1;
+    size_t depth = (size_t)(newest - frame_index + 1);
+    int64_t enqueued = buffer->getEnqueueTime(frame_index);
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t latency = enqueued >= 0 ? now - enqueued : 0;
+    if(depth > max_queue_frames_.load(std::memory_order_relaxed)){
+        max_queue_frames_.store(depth,std::memory_order_relaxed);
+    }
+    if(latency > max_latency_ns_.load(std::memory_order_relaxed)){
+        max_latency_ns_.store(latency,std::memory_order_relaxed);
+    }
+
+    int64_t max_latency = (int64_t)drop_config_.max_latency_ms * 1000000;
+    bool over_depth = drop_config_.max_queue_frames > 0 && depth > drop_config_.max_queue_frames;
+    bool over_latency = max_latency > 0 && latency > max_latency;
+    if(!over_depth && !over_latency){
+        return frame_index;
+    }
+
+    int64_t target = frame_index;
+    switch(drop_config_.policy){
+        case DropPolicy::DROP_OLDEST:
+            if(over_depth){
+                target = newest - (int64_t)drop_config_.max_queue_frames + 1;
+            }
+            //再按延迟往后跳，至少保留最新一帧
+            while(max_latency > 0 && target < newest){
+                int64_t t = buffer->getEnqueueTime(target);
+                if(t < 0 || now - t <= max_latency){
+                    break;
+                }
+                target++;
+            }
+            break;
+        case DropPolicy::DROP_TO_LATEST:
+            target = newest;
+            //被跳过的帧从未送入编码器，参考链不受影响，无需关键帧；是否插入由配置决定
+            force_keyframe = force_keyframe || (drop_config_.keyframe_on_drop && target != frame_index);
+            break;
+        case DropPolicy::DECIMATE:{
+            double src_fps = video_time_base_.num > 0 ? (double)video_time_base_.den / video_time_base_.num : 0.0;
+            double dst_fps = drop_config_.decimate_fps > 0 ? drop_config_.decimate_fps : src_fps / 2;
+            int64_t step = dst_fps > 0 ? std::max<int64_t>(1,(int64_t)(src_fps / dst_fps + 0.5)) : 1;
+            //只编码序号为step整数倍的帧，下一帧还没到时等待它
+            if(frame_index % step != 0){
+                target = (frame_index / step + 1) * step;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    if(target > frame_index){
+        dropped_frames_.fetch_add(target - frame_index,std::memory_order_relaxed);
+        drop_events_.fetch_add(1,std::memory_order_relaxed);
+    }
+    return target;
+}
+
+FrameDropStats EncodingCoordinator::getFrameDropStats() const{
+    FrameDropStats stats;
+    stats.dropped_frames = dropped_frames_.load(std::memory_order_relaxed);
+    stats.drop_events = drop_events_.load(std::memory_order_relaxed);
+    stats.forced_keyframes = forced_keyframes_.load(std::memory_order_relaxed);
+    stats.max_queue_frames = max_queue_frames_.load(std::memory_order_relaxed);
+    stats.max_latency_ms = max_latency_ns_.load(std::memory_order_relaxed) / 1e6;
+    return stats;
+}
+
 void EncodingCoordinator::packetMuxingLoop(){
     AVRational srcTimebase;
     while(!should_stop_){
@@ -214,7 +323,7 @@ void EncodingCoordinator::packetMuxingLoop(){
             fprintf(stderr,"Failed to write packet to muxer\n");
         }
 
-        av_packet_free(&pkt);
+        PacketPool::instance().release(pkt);
     }
 }
 
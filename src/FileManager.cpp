@@ -2,9 +2,15 @@
 #include <iostream>
 #include <cstdio>
 #include <filesystem>
+#include <map>
+#include <set>
+#include <thread>
+#include <algorithm>
+#include "videoDecoder.hpp"
+#include "audioDecoder.hpp"
+#include "VideoEncoder.hpp"
+#include "FormatConverter.hpp"
 
-#define AUDIO_INBUF_SIZE 20480
-#define AUDIO_REFILL_THRESH 4096
 FileManager::FileManager(){}
 
 FileManager::~FileManager() {}
@@ -13,17 +19,14 @@ void FileManager::process_raw(const std::string& inputPath,
                      const std::string& outputDir,
                      MediaType mediaType,
                      BaseDecoder* decoder){
-    
-    uint8_t *data;
-    size_t   data_size;
-
     if (!decoder->isInitialized()) {
         std::cerr << "Decoder is not initialized." << std::endl;
         exit(1);
     }
+    decoder->setDecodeQuality(decodeQuality);
 
-    FILE* inputFile = fopen(inputPath.c_str(), "rb");
-    if (!inputFile) {
+    RawStreamReader reader(rawReadWindow);
+    if (!reader.open(inputPath)) {
         std::cerr << "Failed to open input file: " << inputPath << std::endl;
         exit(1);
     }
@@ -35,13 +38,13 @@ void FileManager::process_raw(const std::string& inputPath,
         }   
     switch(mediaType){
         case MediaType::VIDEO:
-            processVideo(inputFile,inputPath,outputDir,decoder,pkt,data,data_size);
+            processVideo(reader,inputPath,outputDir,decoder,pkt);
             break;
         case MediaType::AUDIO:
-            processAudio(inputFile,inputPath,outputDir,decoder,pkt,data,data_size);
+            processAudio(reader,inputPath,outputDir,decoder,pkt);
             break;
     }
-    fclose(inputFile);
+    reader.close();
     av_packet_free(&pkt);
 }
 
@@ -50,48 +53,478 @@ void FileManager::process_mux(const std::string& inputPath,
                      Demuxer* demuxer,
                      BaseDecoder* decoder_audio,
                      BaseDecoder* decoder_video){
-    int ret = 0;
-
     std::string audioPath = buildOutputFilePath(outputDir,inputPath,".pcm");
     std::string videoPath = buildOutputFilePath(outputDir, inputPath, ".yuv");
 
-    if(demuxer->loadfile(inputPath.c_str())){
-        demuxer->open_video_format();
-        demuxer->open_audio_format();
-        decoder_audio->initialize_fromstream(demuxer->get_audiostream()->codecpar);
-        decoder_video->initialize_fromstream(demuxer->get_videostream()->codecpar);
-        std::unique_ptr<FrameWriter> writer_video = FrameWriterFactory::createWriter(videoPath, MediaType::VIDEO);
-        std::unique_ptr<FrameWriter> writer_audio = FrameWriterFactory::createWriter(audioPath, MediaType::AUDIO);
-        writer_video->open();
-        writer_audio->open();
-        AVFormatContext* fmt_ctx = demuxer->get_fmx();
-        AVPacket* pkt = av_packet_alloc();
-        if (!pkt) {
+    if(!demuxer->loadfile(inputPath.c_str())){
+        return;
+    }
+
+    //流索引 -> 消费者，未登记的流在解封装层直接丢弃
+    //传入的解码器负责各类型的默认流，同类型的其他流（如第二条音轨）另建解码器，输出文件名带上流索引
+    std::map<int, StreamRoute> routes;
+    std::vector<std::unique_ptr<BaseDecoder>> extra_decoders;
+    std::vector<std::unique_ptr<FrameWriter>> writers;
+    if(decoder_video){
+        decoder_video->setThreadConfig(decoderThreadConfig);
+        decoder_video->setDecodeQuality(decodeQuality);
+    }
+    if(decoder_audio){
+        decoder_audio->setThreadConfig(decoderThreadConfig);
+    }
+    int default_video = decoder_video && demuxer->open_video_format() ? demuxer->getVideoStreamIndex() : -1;
+    int default_audio = decoder_audio && demuxer->open_audio_format() ? demuxer->getAudioStreamIndex() : -1;
+
+    auto addRoutes = [&](AVMediaType type, BaseDecoder* primary, int default_idx,
+                         const std::string& path, const char* suffix, MediaType media) {
+        if(!primary){
+            return;
+        }
+        for(int idx : demuxer->getStreamIndices(type)){
+            AVStream* st = demuxer->getStream(idx);
+            //封面图只有一帧，不作为视频输出
+            if(st->disposition & AV_DISPOSITION_ATTACHED_PIC){
+                demuxer->unselectStream(idx);
+                continue;
+            }
+            BaseDecoder* decoder = primary;
+            std::string outputPath = path;
+            if(idx != default_idx){
+                if(type == AVMEDIA_TYPE_VIDEO){
+                    extra_decoders.emplace_back(new videoDecoder());
+                }else{
+                    extra_decoders.emplace_back(new AudioDecoder());
+                }
+                decoder = extra_decoders.back().get();
+                decoder->setThreadConfig(decoderThreadConfig);
+                decoder->setDecodeQuality(primary->getDecodeQuality());
+                outputPath = buildOutputFilePath(outputDir, inputPath, "_" + std::to_string(idx) + suffix);
+            }
+            //解码器打不开的流不再读取
+            if(!decoder->initialize_fromstream(st->codecpar)){
+                fprintf(stderr, "Could not open decoder for stream %d, skipped\n", idx);
+                demuxer->unselectStream(idx);
+                continue;
+            }
+            demuxer->selectStream(idx);
+            writers.push_back(FrameWriterFactory::createWriter(outputPath, media));
+            writers.back()->open();
+            routes[idx] = {decoder, writers.back().get()};
+        }
+    };
+    addRoutes(AVMEDIA_TYPE_VIDEO, decoder_video, default_video, videoPath, ".yuv", MediaType::VIDEO);
+    addRoutes(AVMEDIA_TYPE_AUDIO, decoder_audio, default_audio, audioPath, ".pcm", MediaType::AUDIO);
+    if(routes.empty()){
+        fprintf(stderr, "No decodable stream in %s\n", inputPath.c_str());
+        return;
+    }
+    demuxer->applyStreamDiscard();
+
+    demuxer->startPrefetch();
+    AVPacket* pkt = av_packet_alloc();
+    if (!pkt) {
         fprintf(stderr, "Could not allocate packet\n");
         exit(1);
-        }   
-        while (av_read_frame(fmt_ctx, pkt) >= 0) {
-        if (pkt->stream_index == demuxer->getVideoStreamIndex()){
-            if(ret = decoder_video->sendPacketAndReceiveFrame(pkt)){
-                writer_video->writeFrame(decoder_video->getFrame());
-            }
+    }
+    while (demuxer->readPacket(pkt) >= 0) {
+        auto it = routes.find(pkt->stream_index);
+        if (it != routes.end()) {
+            FrameWriter* writer = it->second.writer;
+            it->second.decoder->decode(pkt, [writer](AVFrame* frame) {
+                writer->writeFrame(frame);
+                return true;
+            });
         }
-        else if (pkt->stream_index == demuxer->getAudioStreamIndex()){
-            if(ret = decoder_audio->sendPacketAndReceiveFrame(pkt)){
-                writer_audio->writeFrame(decoder_audio->getFrame());
+        av_packet_unref(pkt);
+    }
+    for (auto& kv : routes) {
+        FrameWriter* writer = kv.second.writer;
+        kv.second.decoder->drain([writer](AVFrame* frame) {
+            writer->writeFrame(frame);
+            return true;
+        });
+    }
+    demuxer->stopPrefetch();
+    av_packet_free(&pkt);
+}
+
+void FileManager::process_remux(const std::string& inputPath,
+                     const std::string& outputDir,
+                     Demuxer* demuxer,
+                     const std::string& format){
+    std::string outputPath = buildOutputFilePath(outputDir, inputPath, "." + format);
+    if(!demuxer->loadfile(inputPath.c_str())){
+        return;
+    }
+
+    AVMuxer muxer(outputPath, format);
+    if(!muxer.init()){
+        fprintf(stderr, "Could not create output %s\n", outputPath.c_str());
+        return;
+    }
+    muxer.setLogPackets(false);
+
+    //输入流索引 -> 输出流索引，目标容器能容纳的流全部拷贝
+    std::map<int, int> stream_map;
+    for (int i = 0; i < demuxer->getStreamCount(); i++) {
+        AVMediaType type = demuxer->getStream(i)->codecpar->codec_type;
+        if (type != AVMEDIA_TYPE_VIDEO && type != AVMEDIA_TYPE_AUDIO && type != AVMEDIA_TYPE_SUBTITLE) {
+            continue;
+        }
+        int out = muxer.addStreamCopy(demuxer->getStream(i));
+        if (out >= 0) {
+            stream_map[i] = out;
+            demuxer->selectStream(i);
+        }
+    }
+    if(stream_map.empty()){
+        fprintf(stderr, "No stream can be remuxed into %s\n", format.c_str());
+        return;
+    }
+    demuxer->applyStreamDiscard();
+    if(muxer.writeHeader() < 0){
+        return;
+    }
+
+    AVFormatContext* fmt_ctx = demuxer->get_fmx();
+    AVPacket* pkt = av_packet_alloc();
+    if (!pkt) {
+        fprintf(stderr, "Could not allocate packet\n");
+        exit(1);
+    }
+    demuxer->startPrefetch();
+    while (demuxer->readPacket(pkt) >= 0) {
+        auto it = stream_map.find(pkt->stream_index);
+        if (it != stream_map.end()) {
+            AVRational src_tb = fmt_ctx->streams[pkt->stream_index]->time_base;
+            pkt->stream_index = it->second;
+            pkt->pos = -1;
+            if (!muxer.writePacket(pkt, src_tb)) {
+                av_packet_unref(pkt);
+                break;
             }
         }
         av_packet_unref(pkt);
-        if (ret < 0)
-            break;
     }
-    decoder_audio->flush();
-    writer_audio->writeFrame(decoder_audio->getFrame());
-
-    decoder_video->flush();
-    writer_video->writeFrame(decoder_video->getFrame()); 
+    demuxer->stopPrefetch();
     av_packet_free(&pkt);
+    muxer.finalize();
+}
+
+BatchStats FileManager::process_batch(const std::string& manifestPath,
+                                      const std::string& outputDir,
+                                      int workers){
+    std::vector<BatchItem> items;
+    if (!BatchDecodeService::loadManifest(manifestPath, items, outputDir)) {
+        return BatchStats();
+    }
+    BatchDecodeService::Config config;
+    config.workers = workers;
+    config.thread_config = decoderThreadConfig;
+    config.quality = decodeQuality;
+    BatchDecodeService service(config);
+    return service.run(items);
+}
+
+void FileManager::process_chunked(const std::string& inputPath,
+                     const std::string& outputDir,
+                     int workers,
+                     int bit_rate,
+                     const char* encoder_name,
+                     const std::string& format){
+    int cores = (int)std::max(1u, std::thread::hardware_concurrency());
+    if (workers <= 0) {
+        workers = cores;
+    }
+
+    //主线程只负责建立关键帧索引并切分区间，sidecar随后被各worker复用
+    Demuxer probe;
+    probe.setKeyframeIndexEnabled(true);
+    if (!probe.loadfile(inputPath.c_str()) || !probe.open_video_format()) {
+        fprintf(stderr, "No video stream in %s\n", inputPath.c_str());
+        return;
+    }
+    std::vector<ChunkRange> ranges;
+    const std::vector<KeyframeIndex::Entry>* keyframes =
+        probe.getKeyframeIndex().entries(probe.getVideoStreamIndex());
+    int nb_chunks = keyframes ? std::min<int>(workers, (int)keyframes->size()) : 1;
+    nb_chunks = std::max(1, nb_chunks);
+    for (int i = 0; i < nb_chunks; i++) {
+        //没有索引时整个文件作为一段
+        ChunkRange range = {AV_NOPTS_VALUE, AV_NOPTS_VALUE, AV_NOPTS_VALUE};
+        if (keyframes) {
+            size_t first = i * keyframes->size() / nb_chunks;
+            if (i > 0) {
+                range.start_pts = (*keyframes)[first].pts;
+                range.read_pts = (*keyframes)[first - 1].pts;
+            }
+            if (i < nb_chunks - 1) {
+                range.end_pts = (*keyframes)[(i + 1) * keyframes->size() / nb_chunks].pts;
+            }
+        }
+        ranges.push_back(range);
+    }
+
+    int encoder_threads = std::max(1, cores / nb_chunks);
+    std::vector<ChunkResult> results(nb_chunks);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nb_chunks; i++) {
+        threads.emplace_back(&FileManager::transcodeChunk, this, std::cref(inputPath), std::cref(ranges[i]),
+                             bit_rate, encoder_name, encoder_threads, std::ref(results[i]));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    bool ok = std::all_of(results.begin(), results.end(), [](const ChunkResult& r) { return r.ok; });
+    std::string outputPath = buildOutputFilePath(outputDir, inputPath, "." + format);
+    AVMuxer muxer(outputPath, format);
+    int out_index = -1;
+    if (ok && muxer.init()) {
+        muxer.setLogPackets(false);
+        out_index = muxer.addVideoStream(results[0].codecpar);
+    }
+
+    //音频不转码，从源文件流拷贝
+    Demuxer audio_src;
+    AVStream* audio_in = nullptr;
+    int audio_out = -1;
+    if (out_index >= 0 && audio_src.loadfile(inputPath.c_str()) && audio_src.open_audio_format()) {
+        audio_in = audio_src.get_audiostream();
+        audio_out = muxer.addStreamCopy(audio_in);
+        if (audio_out >= 0) {
+            audio_src.applyStreamDiscard();
+        } else {
+            audio_in = nullptr;
+        }
+    }
+    if (out_index < 0 || muxer.writeHeader() < 0) {
+        fprintf(stderr, "Chunked transcode of %s failed\n", inputPath.c_str());
+        ok = false;
+    }
+
+    //视频时间戳从0开始，音频减去同样的起点
+    AVStream* video_in = probe.get_videostream();
+    int64_t video_start = video_in->start_time != AV_NOPTS_VALUE ? video_in->start_time : 0;
+    AVPacket* audio_pkt = audio_in ? av_packet_alloc() : nullptr;
+    bool audio_pending = false;
+    auto write_audio_until = [&](int64_t ts, AVRational tb) {
+        while (audio_pkt) {
+            if (!audio_pending) {
+                if (audio_src.readPacket(audio_pkt) < 0) {
+                    av_packet_free(&audio_pkt);
+                    return;
+                }
+                if (audio_pkt->stream_index != audio_in->index) {
+                    av_packet_unref(audio_pkt);
+                    continue;
+                }
+                int64_t shift = av_rescale_q(video_start, video_in->time_base, audio_in->time_base);
+                if (audio_pkt->pts != AV_NOPTS_VALUE) audio_pkt->pts -= shift;
+                if (audio_pkt->dts != AV_NOPTS_VALUE) audio_pkt->dts -= shift;
+                audio_pending = true;
+            }
+            int64_t audio_ts = audio_pkt->dts != AV_NOPTS_VALUE ? audio_pkt->dts : audio_pkt->pts;
+            if (ts != INT64_MAX && audio_ts != AV_NOPTS_VALUE &&
+                av_compare_ts(audio_ts, audio_in->time_base, ts, tb) > 0) {
+                return;
+            }
+            audio_pkt->stream_index = audio_out;
+            audio_pkt->pos = -1;
+            muxer.writePacket(audio_pkt, audio_in->time_base);
+            av_packet_unref(audio_pkt);
+            audio_pending = false;
+        }
+    };
+
+    //分段编码器不产生B帧重排，段间只可能因取整出现dts重叠；整段平移一个固定偏移，不改段内的pts/dts关系
+    int64_t last_dts = AV_NOPTS_VALUE;
+    for (ChunkResult& r : results) {
+        int64_t offset = 0;
+        if (!r.packets.empty() && last_dts != AV_NOPTS_VALUE && r.packets.front()->dts != AV_NOPTS_VALUE &&
+            r.packets.front()->dts <= last_dts) {
+            offset = last_dts + 1 - r.packets.front()->dts;
+        }
+        for (AVPacket*& pkt : r.packets) {
+            if (ok) {
+                if (pkt->pts != AV_NOPTS_VALUE) pkt->pts += offset;
+                if (pkt->dts != AV_NOPTS_VALUE) {
+                    pkt->dts += offset;
+                    last_dts = pkt->dts;
+                    write_audio_until(pkt->dts, r.time_base);
+                }
+                pkt->stream_index = out_index;
+                muxer.writePacket(pkt, r.time_base);
+            }
+            PacketPool::instance().release(pkt);
+        }
+        avcodec_parameters_free(&r.codecpar);
+    }
+    if (ok) {
+        write_audio_until(INT64_MAX, AV_TIME_BASE_Q);
+        muxer.finalize();
+    }
+    av_packet_free(&audio_pkt);
+}
+
+void FileManager::transcodeChunk(const std::string& inputPath, const ChunkRange& range,
+                                 int bit_rate, const char* encoder_name, int encoder_threads,
+                                 ChunkResult& result){
+    Demuxer demuxer;
+    demuxer.setKeyframeIndexEnabled(true);
+    if (!demuxer.loadfile(inputPath.c_str()) || !demuxer.open_video_format()) {
+        return;
+    }
+    demuxer.applyStreamDiscard();
+    AVStream* st = demuxer.get_videostream();
+
+    videoDecoder decoder;
+    //多段并行时每段的解码线程同样按核数分摊
+    DecoderThreadConfig thread_config = decoderThreadConfig;
+    if (thread_config.auto_tune && thread_config.max_threads <= 0) {
+        thread_config.max_threads = encoder_threads;
+    }
+    decoder.setThreadConfig(thread_config);
+    decoder.setDecodeQuality(decodeQuality);
+    if (!decoder.initialize_fromstream(st->codecpar)) {
+        return;
+    }
+
+    //编码器沿用源流时间基，29.97或可变帧率的输入不会因{1,fps}取整产生重复pts；fps只用于GOP长度
+    AVRational fr = av_guess_frame_rate(demuxer.get_fmx(), st, nullptr);
+    int fps = (fr.num > 0 && fr.den > 0) ? (int)(av_q2d(fr) + 0.5) : 25;
+    AVRational frame_duration = (fr.num > 0 && fr.den > 0) ? av_inv_q(fr) : AVRational{1, fps};
+    AVRational enc_tb = st->time_base;
+    int64_t stream_start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+
+    std::unique_ptr<VideoFilter> filter;
+    VideoEncoder encoder;
+    bool encoder_ready = false;
+    bool first_frame = true;
+    //编码参数按首帧确定，之后分辨率或像素格式变化的帧先转换回首帧格式
+    MediaFormatConverter converter;
+    AVFrame* scaled = av_frame_alloc();
+
+    auto drain = [&]() {
+        while (AVPacket* out = encoder.getEncodedPacket()) {
+            result.packets.push_back(out);
+        }
+    };
+    auto encode = [&](AVFrame* frame) -> bool {
+        if (!encoder_ready) {
+            encoder.setVideoParams(frame->width, frame->height, bit_rate, fps);
+            encoder.setPixelFormat((AVPixelFormat)frame->format);
+            encoder.setTimeBase(enc_tb, fr);
+            AVDictionary* opts = nullptr;
+            av_dict_set_int(&opts, "threads", encoder_threads, 0);
+            //各段独立编码后直接拼接，不允许B帧重排，否则段首dts会早于上一段末尾
+            av_dict_set_int(&opts, "bf", 0, 0);
+            encoder_ready = encoder.init(encoder_name, AV_CODEC_ID_NONE, opts);
+            av_dict_free(&opts);
+            if (!encoder_ready) {
+                return false;
+            }
+            AVPixelFormat fmt = (AVPixelFormat)frame->format;
+            if (!converter.initVideoConverter(frame->width, frame->height, fmt,
+                                              frame->width, frame->height, fmt)) {
+                return false;
+            }
+        }
+        if (converter.needVideoConversion(frame)) {
+            if (!scaled || !converter.convertVideoInto(frame, scaled)) {
+                return false;
+            }
+            frame = scaled;
+        }
+        //每段首帧强制为关键帧，其余由编码器自行决定
+        frame->pict_type = first_frame ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+        first_frame = false;
+        encoder.encode(frame);
+        drain();
+        return true;
+    };
+    //本段拥有的包的时间戳(pts，缺失时用dts)；从前一个关键帧开始读到的帧只用作参考，按时间戳去重，不输出
+    //只有一段时不需要区分，时间戳缺失的帧也全部保留
+    std::set<int64_t> owned_ts;
+    bool whole_file = range.start_pts == AV_NOPTS_VALUE && range.end_pts == AV_NOPTS_VALUE;
+    bool owning = range.start_pts == AV_NOPTS_VALUE;
+    int64_t last_ts = AV_NOPTS_VALUE;
+    int64_t frame_step = std::max<int64_t>(1, av_rescale_q(1, frame_duration, st->time_base));
+    auto handle = [&](AVFrame* frame) -> bool {
+        int64_t ts = frame->best_effort_timestamp;
+        if (ts == AV_NOPTS_VALUE) ts = frame->pts;
+        if (ts == AV_NOPTS_VALUE) ts = frame->pkt_dts;
+        if (!whole_file && (ts == AV_NOPTS_VALUE || owned_ts.erase(ts) == 0)) {
+            return true;
+        }
+        //缺失或回退的时间戳按猜测帧率补一帧的间隔
+        if (ts == AV_NOPTS_VALUE || (last_ts != AV_NOPTS_VALUE && ts <= last_ts)) {
+            ts = last_ts == AV_NOPTS_VALUE ? stream_start : last_ts + frame_step;
+        }
+        last_ts = ts;
+        frame->pts = ts - stream_start;
+        if (!enableVideoFilter) {
+            return encode(frame);
+        }
+        if (!filter) {
+            filter = std::make_unique<VideoFilter>(currentParamsVideo, frame->width, frame->height,
+                                                   (AVPixelFormat)frame->format, enc_tb,
+                                                   frame->sample_aspect_ratio);
+        }
+        filter->push_frame(frame);
+        while (AVFrame* filt = filter->pull_frame()) {
+            bool ok = encode(filt);
+            av_frame_free(&filt);
+            if (!ok) return false;
+        }
+        return true;
+    };
+
+    bool ok = true;
+    int64_t read_us = range.read_pts == AV_NOPTS_VALUE ? INT64_MIN
+                      : av_rescale_q(range.read_pts, st->time_base, AV_TIME_BASE_Q);
+    auto on_frame = [&](AVFrame* frame) {
+        ok = handle(frame);
+        return ok;
+    };
+    //段边界按关键帧包切分：读到下一段的起始关键帧即停止
+    demuxer.readRange(read_us, INT64_MAX, [&](AVPacket* pkt) {
+        int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+        if ((pkt->flags & AV_PKT_FLAG_KEY) && ts != AV_NOPTS_VALUE) {
+            if (range.end_pts != AV_NOPTS_VALUE && ts >= range.end_pts) {
+                return false;
+            }
+            if (!owning && ts >= range.start_pts) {
+                owning = true;
+            }
+        }
+        if (owning && !whole_file && ts != AV_NOPTS_VALUE) {
+            owned_ts.insert(ts);
+        }
+        return decoder.decode(pkt, on_frame) >= 0 && ok;
+    });
+    if (ok) {
+        decoder.drain(on_frame);
     }
+    //滤镜中缓存的帧在段尾送出
+    if (ok && filter) {
+        filter->push_frame(nullptr);
+        while (AVFrame* filt = filter->pull_frame()) {
+            ok = encode(filt);
+            av_frame_free(&filt);
+            if (!ok) break;
+        }
+    }
+    av_frame_free(&scaled);
+    if (!ok || !encoder_ready) {
+        return;
+    }
+    encoder.flush();
+    drain();
+
+    result.codecpar = encoder.getCodecParameters();
+    result.time_base = encoder.getCodecContext()->time_base;
+    result.ok = result.codecpar != nullptr;
 }
 
 std::string FileManager::buildOutputFilePath(const std::string& outputDir, const std::string& inputPath, const std::string& newSuffix) {
@@ -109,92 +542,96 @@ std::string FileManager::buildOutputFilePath(const std::string& outputDir, const
     return outputFile.string();
 }
 
-void FileManager::processVideo(FILE* inputFile, const std::string& inputPath,
+bool FileManager::feedRawStream(RawStreamReader& reader, BaseDecoder* decoder,
+                                AVPacket* pkt, const FrameCallback& onFrame) {
+    uint8_t* data = nullptr;
+    size_t size = 0;
+    //解析器跨窗口缓存不完整的帧，窗口之间无需重叠
+    while (reader.next(data, size)) {
+        while (size > 0) {
+            if (!decoder->parsePacket(data, size, pkt)) {
+                return false;
+            }
+            if (pkt->size > 0) {
+                decoder->decode(pkt, onFrame);
+                av_packet_unref(pkt);
+            }
+        }
+    }
+    //读取出错时不能当作完整文件冲刷
+    if (reader.error()) {
+        return false;
+    }
+    //冲刷解析器中最后一帧
+    do {
+        data = nullptr;
+        size = 0;
+        decoder->parsePacket(data, size, pkt);
+        if (pkt->size > 0) {
+            decoder->decode(pkt, onFrame);
+            av_packet_unref(pkt);
+        }
+    } while (pkt->size > 0);
+    return true;
+}
+
+void FileManager::processVideo(RawStreamReader& reader, const std::string& inputPath,
                                const std::string& outputDir, BaseDecoder* decoder,
-                               AVPacket* pkt, uint8_t*& data, size_t& data_size) {
+                               AVPacket* pkt) {
     std::string outputFilePath = buildOutputFilePath(outputDir, inputPath, ".yuv");
     auto writer = FrameWriterFactory::createWriter(outputFilePath, MediaType::VIDEO);
     writer->open();
 
-    constexpr int bufferSize = INBUF_SIZE;
-    uint8_t buffer[INBUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE] = {0};  
-    memset(buffer + bufferSize, 0, AV_INPUT_BUFFER_PADDING_SIZE);
     bool isFirstFrame = true; 
-    bool eof = false;
-    do {
-        size_t bytesRead = fread(buffer, 1, bufferSize, inputFile);
-        if (ferror(inputFile)) {
-            std::cerr << "Error reading input file" << std::endl;
-            exit(1);
+    auto onFrame = [&](AVFrame* frame) {
+        if(isFirstFrame){
+            savedWidth = frame->width;
+            savedHeight = frame->height;
+            pix_fmt = (AVPixelFormat)frame->format;
+            videoTimebase = {1, 30};
+            sample_aspect_ratio = frame->sample_aspect_ratio;
+            videoFilter = std::make_shared<VideoFilter>(currentParamsVideo,
+                                            savedWidth,
+                                            savedHeight,
+                                            pix_fmt,
+                                            videoTimebase,
+                                            sample_aspect_ratio);
+            isFirstFrame = false;       
         }
-        eof = !bytesRead;
-        data = buffer;
-        
-        while (bytesRead > 0 || eof) {
-            decoder->parsePacket(data, bytesRead, pkt);
-            if (pkt->size > 0 && decoder->sendPacketAndReceiveFrame(pkt)) {
-                AVFrame* frame = decoder->getFrame();
-                if(isFirstFrame){
-                    savedWidth = frame->width;
-                    savedHeight = frame->height;
-                    pix_fmt = (AVPixelFormat)frame->format;
-                    videoTimebase = {1, 30};
-                    sample_aspect_ratio = frame->sample_aspect_ratio;
-                    videoFilter = std::make_shared<VideoFilter>(currentParamsVideo,
-                                                    savedWidth,
-                                                    savedHeight,
-                                                    pix_fmt,
-                                                    videoTimebase,
-                                                    sample_aspect_ratio);
-                    isFirstFrame = false;       
-                }
 
-                av_packet_unref(pkt);
-                if(enableVideoFilter){
-                    videoFilter->push_frame(frame);
-                     while (AVFrame* filt = videoFilter->pull_frame()) {
-                        writer->writeFrame(filt);
-                        av_frame_free(&filt);
-                    }
-                }
-                else{
-                    if (!writer->writeFrame(frame)) {
-                    std::cerr << "Failed to save frame\n";
-                    exit(1);
-                    }
-                }
-            } else if (eof) {
-                break;
+        if(enableVideoFilter){
+            videoFilter->push_frame(frame);
+             while (AVFrame* filt = videoFilter->pull_frame()) {
+                writer->writeFrame(filt);
+                av_frame_free(&filt);
             }
         }
-    } while (!eof);
-
-    decoder->flush();
-    if (AVFrame* frame = decoder->getFrame()) {
-        writer->writeFrame(frame);
+        else{
+            if (!writer->writeFrame(frame)) {
+            std::cerr << "Failed to save frame\n";
+            exit(1);
+            }
+        }
+        return true;
+    };
+    if (!feedRawStream(reader, decoder, pkt, onFrame)) {
+        std::cerr << "Error reading input file" << std::endl;
+        exit(1);
     }
+
+    decoder->drain(onFrame);
     writer->close();
 }
 
-void FileManager::processAudio(FILE* inputFile, const std::string& inputPath,
+void FileManager::processAudio(RawStreamReader& reader, const std::string& inputPath,
                                const std::string& outputDir, BaseDecoder* decoder,
-                               AVPacket* pkt, uint8_t*& data, size_t& data_size) {
-        int len,ret;
-        uint8_t inbuf[AUDIO_INBUF_SIZE + AV_INPUT_BUFFER_PADDING_SIZE];
-        data = inbuf;
-        data_size = fread(inbuf, 1, AUDIO_INBUF_SIZE, inputFile);
+                               AVPacket* pkt) {
         std::string outputFilePath = buildOutputFilePath(outputDir, inputPath, ".pcm");
         std::unique_ptr<FrameWriter> writer = FrameWriterFactory::createWriter(outputFilePath, MediaType::AUDIO);
         writer->open();
         //循环读取，
-        AVFrame *decoded_frame = NULL;
         bool isFirstFrame = true; 
-        
-        while(data_size > 0){
-            decoder->parsePacket(data,data_size,pkt);
-            if(pkt->size>0 && decoder->sendPacketAndReceiveFrame(pkt)){
-                    AVFrame* frame = decoder->getFrame();
-                    av_packet_unref(pkt);
+        auto onFrame = [&](AVFrame* frame) {
                     int channels = decoder->get_channels();
                     int sampleRats = decoder->get_bytes_per_sample();
                     if(isFirstFrame){
@@ -228,17 +665,14 @@ void FileManager::processAudio(FILE* inputFile, const std::string& inputPath,
                     }
                     writer->writeFrame(frame);
                     }
-                   
-                    if(data_size < AUDIO_REFILL_THRESH){
-                        memmove(inbuf,data,data_size);
-                        data = inbuf;
-                        len = fread(data+data_size , 1, AUDIO_INBUF_SIZE - data_size, inputFile);
-                        if(len > 0)
-                            data_size += len; 
-                    }
-            }
+                    return true;
+        };
+
+        if(!feedRawStream(reader, decoder, pkt, onFrame)){
+            std::cerr << "Error reading input file" << std::endl;
+            exit(1);
         }
-        decoder->flush();
+        decoder->drain(onFrame);
         writer->close();
         if (enableAudioFilter) {
             closeAudioFilter();
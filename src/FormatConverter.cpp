@@ -1,11 +1,19 @@
 #include "FormatConverter.hpp"
+#include <algorithm>
+extern "C"{
+    #include <libavcodec/avcodec.h>
+}
 
 MediaFormatConverter::MediaFormatConverter()
     : sws_ctx_(nullptr)
-    , converted_video_frame_(nullptr)
+    , video_pool_(nullptr)
     , video_converter_initialized_(false)
+    , video_threads_(0)
+    , active_video_threads_(1)
     , swr_ctx_(nullptr)
-    , converted_audio_frame_(nullptr)
+    , audio_pool_(nullptr)
+    , audio_pool_samples_(0)
+    , audio_linesize_(0)
     , audio_converter_initialized_(false)
     , dst_video_width_(0), dst_video_height_(0)
     , dst_video_format_(AV_PIX_FMT_NONE)
@@ -19,124 +27,199 @@ MediaFormatConverter::~MediaFormatConverter() {
     cleanup();
 }
 
-bool MediaFormatConverter::initVideoConverter(int src_width, int src_height, AVPixelFormat& src_format,
-                                             int dst_width, int dst_height, AVPixelFormat& dst_format) {
-    
-    if(src_width == dst_width && src_height == dst_height || src_format == dst_format){
-        printf("don't need convert");
-        return true;
-    }
-    
-    //创建转换上下文
-    if(sws_ctx_){
-        sws_freeContext(sws_ctx_);
-        sws_ctx_ = nullptr;
-    }
-    sws_ctx_ = sws_getContext(
-    src_width, src_height, src_format,      
-    dst_width, dst_height, dst_format,      
-    SWS_BICUBIC, nullptr, nullptr, nullptr 
-    );
+#ifdef SWS_HAS_THREADS
+//自动线程数按每线程约270行：720p为2，1080p为4，4K为8；分片太薄时线程开销反而更大
+//用bench/sws_threads_bench.cpp在目标机器上测各分辨率的最佳线程数来校准
+static const int kRowsPerScaleThread = 270;
+#endif
 
-    if(!sws_ctx_){
-        fprintf(stderr,"can not create convert");
-        return false;
+int MediaFormatConverter::resolveVideoThreads(int height) const {
+#ifdef SWS_HAS_THREADS
+    if (video_threads_ > 0) {
+        return video_threads_;
     }
+    int threads = std::max(1, height / kRowsPerScaleThread);
+    return std::min(threads, std::max(1, av_cpu_count()));
+#else
+    (void)height;
+    return 1;
+#endif
+}
+
+bool MediaFormatConverter::initVideoConverter(int src_width, int src_height, AVPixelFormat& src_format,
+                                             int dst_width, int dst_height, AVPixelFormat& dst_format) {
+    releaseVideoRoute();
+    video_converter_initialized_ = false;
     dst_video_width_ = dst_width;
     dst_video_height_ = dst_height;
     dst_video_format_ = dst_format;
-    if(allocateVideoFrame()){
+    if(!initVideoPool()){
+        return false;
+    }
+    //尺寸和格式都相同才不需要转换，源帧直接拷贝到输出
+    if(!selectVideoRoute(src_width, src_height, src_format)){
         return false;
     }
     video_converter_initialized_ = true;
-    printf("视频转换器初始化成功: %dx%d %s -> %dx%d %s\n",
+    if(video_key_.identity()){
+        printf("don't need convert\n");
+        return true;
+    }
+    printf("视频转换器初始化成功: %dx%d %s -> %dx%d %s, %d threads\n",
            src_width, src_height, av_get_pix_fmt_name(src_format),
-           dst_width, dst_height, av_get_pix_fmt_name(dst_format));
+           dst_width, dst_height, av_get_pix_fmt_name(dst_format), active_video_threads_);
     return true;
 }
 
-bool MediaFormatConverter::allocateVideoFrame() {
-    if(converted_video_frame_){
-        av_frame_free(&converted_video_frame_);
+bool MediaFormatConverter::selectVideoRoute(int src_width, int src_height, AVPixelFormat src_format) {
+    VideoConverterKey key;
+    key.src_width = src_width;
+    key.src_height = src_height;
+    key.src_format = src_format;
+    key.dst_width = dst_video_width_;
+    key.dst_height = dst_video_height_;
+    key.dst_format = dst_video_format_;
+    if(key.identity()){
+        releaseVideoRoute();
+        video_key_ = key;
+        return true;
     }
-
-    converted_video_frame_ = av_frame_alloc();
-    if(!converted_video_frame_){
-        fprintf(stderr,"can not alloc frame");
+    key.threads = resolveVideoThreads(std::max(src_height, dst_video_height_));
+    if(sws_ctx_ && key == video_key_){
+        return true;
+    }
+    releaseVideoRoute();
+    sws_ctx_ = ConverterCache::instance().acquireVideo(key);
+    if(!sws_ctx_){
         return false;
     }
+    video_key_ = key;
+    active_video_threads_ = key.threads;
+    return true;
+}
+
+void MediaFormatConverter::releaseVideoRoute() {
+    ConverterCache::instance().releaseVideo(video_key_, sws_ctx_);
+    video_key_ = VideoConverterKey();
+    active_video_threads_ = 1;
+}
 
-    converted_video_frame_->width = dst_video_width_;
-    converted_video_frame_->height = dst_video_height_;
-    converted_video_frame_->format = dst_video_format_;
+bool MediaFormatConverter::needVideoConversion(const AVFrame* frame) const {
+    return video_converter_initialized_ &&
+           (frame->width != dst_video_width_ || frame->height != dst_video_height_ ||
+            frame->format != dst_video_format_);
+}
 
-    int ret = av_frame_get_buffer(converted_video_frame_,0);
-    if(ret < 0){
-        fprintf(stderr,"can not alloc frame buffer");
+//视频帧的行宽按32字节对齐，输出帧全部来自同一个缓冲池
+static const int kVideoAlign = 32;
+
+bool MediaFormatConverter::initVideoPool() {
+    av_buffer_pool_uninit(&video_pool_);
+    int size = av_image_get_buffer_size(dst_video_format_, dst_video_width_, dst_video_height_, kVideoAlign);
+    if(size < 0){
+        fprintf(stderr,"invalid output video format");
+        return false;
+    }
+    video_pool_ = av_buffer_pool_init(size + AV_INPUT_BUFFER_PADDING_SIZE, av_buffer_alloc);
+    if(!video_pool_){
+        fprintf(stderr,"can not alloc frame pool");
         return false;
     }
     return true;
 }
 
-AVFrame* MediaFormatConverter::convertVideo(AVFrame* src_frame) {
+bool MediaFormatConverter::getVideoBuffer(AVFrame* frame) {
+    av_frame_unref(frame);
+    frame->buf[0] = av_buffer_pool_get(video_pool_);
+    if(!frame->buf[0]){
+        fprintf(stderr,"can not alloc frame buffer");
+        return false;
+    }
+    frame->width = dst_video_width_;
+    frame->height = dst_video_height_;
+    frame->format = dst_video_format_;
+    av_image_fill_arrays(frame->data, frame->linesize, frame->buf[0]->data,
+                         dst_video_format_, dst_video_width_, dst_video_height_, kVideoAlign);
+    frame->extended_data = frame->data;
+    return true;
+}
 
-    if (!video_converter_initialized_ || !sws_ctx_ || !converted_video_frame_) {
-        // 无需转换，直接返回源帧的引用
-        printf("converter not init, output src_frame");
-        return av_frame_clone(src_frame);
+bool MediaFormatConverter::convertVideoInto(const AVFrame* src_frame, AVFrame* dst_frame) {
+    if (!video_converter_initialized_ || !dst_frame) {
+        return false;
+    }
+    //源帧尺寸或格式与当前上下文不同时换路
+    if (!selectVideoRoute(src_frame->width, src_frame->height, (AVPixelFormat)src_frame->format)) {
+        return false;
+    }
+    //已有缓冲且独占时原地覆盖，否则换一块池缓冲
+    bool reusable = dst_frame->buf[0] && av_frame_is_writable(dst_frame) &&
+                    dst_frame->width == dst_video_width_ && dst_frame->height == dst_video_height_ &&
+                    dst_frame->format == dst_video_format_;
+    if (!reusable && !getVideoBuffer(dst_frame)) {
+        return false;
     }
-    int ret = sws_scale(sws_ctx_,
+    int ret;
+    if (!sws_ctx_) {
+        ret = av_frame_copy(dst_frame, src_frame);
+    } else
+#ifdef SWS_HAS_THREADS
+    //sws_scale_frame内部会av_frame_ref源帧，非引用计数的源帧会被整帧拷贝，只能走单线程
+    if (active_video_threads_ > 1 && src_frame->buf[0]) {
+        ret = sws_scale_frame(sws_ctx_, dst_frame, src_frame);
+    } else
+#endif
+    {
+        ret = sws_scale(sws_ctx_,
                         src_frame->data,src_frame->linesize,0,src_frame->height,
-                        converted_video_frame_->data,converted_video_frame_->linesize);
-    
+                        dst_frame->data,dst_frame->linesize);
+    }
+
     if(ret < 0){
         fprintf(stderr,"convert fail");
-        return nullptr;
+        return false;
     }
 
-    converted_video_frame_->pts = src_frame->pts;
-    converted_video_frame_->pkt_dts = src_frame->pkt_dts;
-    converted_video_frame_->pkt_duration = src_frame->pkt_duration;
-
-    return av_frame_clone(converted_video_frame_);
+    dst_frame->pts = src_frame->pts;
+    dst_frame->pkt_dts = src_frame->pkt_dts;
+    dst_frame->pkt_duration = src_frame->pkt_duration;
+    return true;
 }
 
-bool MediaFormatConverter::initAudioConverter(AVSampleFormat src_format, int src_sample_rate, AVChannelLayout& src_layout,
-                                             AVSampleFormat dst_format, int dst_sample_rate, AVChannelLayout& dst_layout) {
-    if(src_format == dst_format && src_sample_rate == dst_sample_rate && av_channel_layout_compare(&src_layout, &dst_layout) == 0){
-        printf("don't need convert");
-        return true;
-    }
-    if(swr_ctx_){
-        swr_free(&swr_ctx_);
+AVFrame* MediaFormatConverter::convertVideo(AVFrame* src_frame) {
+
+    if (!needVideoConversion(src_frame)) {
+        // 无需转换，直接返回源帧的引用
+        return av_frame_clone(src_frame);
     }
-    swr_ctx_ = swr_alloc();
-    if(!swr_ctx_){
-        fprintf(stderr,"could not alloc swr");
-        return false;
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) {
+        fprintf(stderr,"can not alloc frame");
+        return nullptr;
     }
-
-    av_opt_set_chlayout(swr_ctx_, "in_chlayout", &src_layout, 0);
-    av_opt_set_int(swr_ctx_, "in_sample_rate", src_sample_rate, 0);
-    av_opt_set_sample_fmt(swr_ctx_, "in_sample_fmt", src_format, 0);
-    
-    av_opt_set_chlayout(swr_ctx_, "out_chlayout", &dst_layout, 0);
-    av_opt_set_int(swr_ctx_, "out_sample_rate", dst_sample_rate, 0);
-    av_opt_set_sample_fmt(swr_ctx_, "out_sample_fmt", dst_format, 0);
-
-    int ret = swr_init(swr_ctx_);
-    if (ret < 0) {
-        fprintf(stderr, "无法初始化音频重采样器\n");
-        swr_free(&swr_ctx_);
-        return false;
+    if (!convertVideoInto(src_frame, frame)) {
+        av_frame_free(&frame);
+        return nullptr;
     }
+    return frame;
+}
 
+bool MediaFormatConverter::initAudioConverter(AVSampleFormat src_format, int src_sample_rate, AVChannelLayout& src_layout,
+                                             AVSampleFormat dst_format, int dst_sample_rate, AVChannelLayout& dst_layout) {
+    releaseAudioRoute();
+    audio_converter_initialized_ = false;
     dst_audio_format_ = dst_format;
     dst_audio_sample_rate_ = dst_sample_rate;
+    av_channel_layout_uninit(&dst_audio_layout_);
     av_channel_layout_copy(&dst_audio_layout_, &dst_layout);
-
-    max_dst_samples_ = swr_get_out_samples(swr_ctx_, 4096);
+    if(!selectAudioRoute(src_format, src_sample_rate, src_layout)){
+        return false;
+    }
     audio_converter_initialized_ = true;
+    if(audio_key_.identity()){
+        printf("don't need convert\n");
+        return true;
+    }
     printf("音频转换器初始化成功: %s %dHz %dch -> %s %dHz %dch\n",
            av_get_sample_fmt_name(src_format), src_sample_rate, src_layout.nb_channels,
            av_get_sample_fmt_name(dst_format), dst_sample_rate, dst_layout.nb_channels);
@@ -144,81 +227,172 @@ bool MediaFormatConverter::initAudioConverter(AVSampleFormat src_format, int src
     return true;
 }
 
-bool MediaFormatConverter::allocateAudioFrame(int nb_samples) {
-    if (converted_audio_frame_) {
-        av_frame_free(&converted_audio_frame_);
+bool MediaFormatConverter::selectAudioRoute(AVSampleFormat src_format, int src_sample_rate, const AVChannelLayout& src_layout) {
+    AudioConverterKey key;
+    key.src_format = src_format;
+    key.src_sample_rate = src_sample_rate;
+    key.src_layout = src_layout;
+    key.dst_format = dst_audio_format_;
+    key.dst_sample_rate = dst_audio_sample_rate_;
+    key.dst_layout = dst_audio_layout_;
+    bool valid = audio_key_.src_format != AV_SAMPLE_FMT_NONE;
+    if(valid && key == audio_key_ && (swr_ctx_ || key.identity())){
+        return true;
     }
-    
-    converted_audio_frame_ = av_frame_alloc();
-    if (!converted_audio_frame_) {
-        return false;
+    //换路时旧重采样器里的延迟样本(通常几毫秒)直接丢弃，不做冲刷
+    releaseAudioRoute();
+    if(!key.identity()){
+        swr_ctx_ = ConverterCache::instance().acquireAudio(key);
+        if(!swr_ctx_){
+            return false;
+        }
     }
-    
-    converted_audio_frame_->format = dst_audio_format_;
-    converted_audio_frame_->sample_rate = dst_audio_sample_rate_;
-    converted_audio_frame_->nb_samples = nb_samples;
-    av_channel_layout_copy(&converted_audio_frame_->ch_layout, &dst_audio_layout_);
-    
-    int ret = av_frame_get_buffer(converted_audio_frame_, 0);
-    if (ret < 0) {
-        av_frame_free(&converted_audio_frame_);
-        return false;
+    audio_key_.src_format = src_format;
+    audio_key_.src_sample_rate = src_sample_rate;
+    av_channel_layout_copy(&audio_key_.src_layout, &src_layout);
+    audio_key_.dst_format = dst_audio_format_;
+    audio_key_.dst_sample_rate = dst_audio_sample_rate_;
+    av_channel_layout_copy(&audio_key_.dst_layout, &dst_audio_layout_);
+    max_dst_samples_ = swr_ctx_ ? swr_get_out_samples(swr_ctx_, 4096) : 4096;
+    return true;
+}
+
+void MediaFormatConverter::releaseAudioRoute() {
+    ConverterCache::instance().releaseAudio(audio_key_, swr_ctx_);
+    av_channel_layout_uninit(&audio_key_.src_layout);
+    av_channel_layout_uninit(&audio_key_.dst_layout);
+    audio_key_ = AudioConverterKey();
+}
+
+bool MediaFormatConverter::needAudioConversion(const AVFrame* frame) const {
+    return audio_converter_initialized_ &&
+           (frame->format != dst_audio_format_ || frame->sample_rate != dst_audio_sample_rate_ ||
+            av_channel_layout_compare(&frame->ch_layout, &dst_audio_layout_) != 0);
+}
+
+bool MediaFormatConverter::getAudioBuffer(AVFrame* frame, int nb_samples) {
+    int channels = dst_audio_layout_.nb_channels;
+    int planes = av_sample_fmt_is_planar(dst_audio_format_) ? channels : 1;
+    if (planes > AV_NUM_DATA_POINTERS) {
+        //声道数超过data[]时需要extended_buf，少见，直接走普通分配
+        av_frame_unref(frame);
+        frame->format = dst_audio_format_;
+        frame->sample_rate = dst_audio_sample_rate_;
+        frame->nb_samples = nb_samples;
+        av_channel_layout_copy(&frame->ch_layout, &dst_audio_layout_);
+        return av_frame_get_buffer(frame, 0) >= 0;
+    }
+    //池按最大样本数建，输出变长时才重建
+    if (!audio_pool_ || nb_samples > audio_pool_samples_) {
+        av_buffer_pool_uninit(&audio_pool_);
+        audio_pool_samples_ = std::max(nb_samples, max_dst_samples_);
+        int size = av_samples_get_buffer_size(&audio_linesize_, channels, audio_pool_samples_, dst_audio_format_, 0);
+        if (size < 0) {
+            return false;
+        }
+        audio_pool_ = av_buffer_pool_init(audio_linesize_, av_buffer_alloc);
+        if (!audio_pool_) {
+            return false;
+        }
     }
+    av_frame_unref(frame);
+    for (int p = 0; p < planes; p++) {
+        frame->buf[p] = av_buffer_pool_get(audio_pool_);
+        if (!frame->buf[p]) {
+            av_frame_unref(frame);
+            return false;
+        }
+        frame->data[p] = frame->buf[p]->data;
+    }
+    frame->extended_data = frame->data;
+    frame->linesize[0] = audio_linesize_;
+    frame->format = dst_audio_format_;
+    frame->sample_rate = dst_audio_sample_rate_;
+    frame->nb_samples = audio_pool_samples_;
+    av_channel_layout_copy(&frame->ch_layout, &dst_audio_layout_);
     return true;
 }
 
-AVFrame* MediaFormatConverter::convertAudio(AVFrame* src_frame) {
-if (!audio_converter_initialized_ || !swr_ctx_) {
-        return av_frame_clone(src_frame);
+bool MediaFormatConverter::convertAudioInto(const AVFrame* src_frame, AVFrame* dst_frame) {
+    if (!audio_converter_initialized_ || !dst_frame) {
+        return false;
     }
-    
-    int dst_nb_samples = swr_get_out_samples(swr_ctx_, src_frame->nb_samples);
+    if (!selectAudioRoute((AVSampleFormat)src_frame->format, src_frame->sample_rate, src_frame->ch_layout)) {
+        return false;
+    }
+    int dst_nb_samples = swr_ctx_ ? swr_get_out_samples(swr_ctx_, src_frame->nb_samples) : src_frame->nb_samples;
     if (dst_nb_samples < 0) {
         fprintf(stderr, "计算输出样本数失败\n");
-        return nullptr;
+        return false;
     }
-    
-    if (!allocateAudioFrame(dst_nb_samples)) {
-        return nullptr;
+    //容量按缓冲大小算，上一次转换后变小的nb_samples不影响复用
+    int channels = dst_audio_layout_.nb_channels;
+    int sample_bytes = av_get_bytes_per_sample(dst_audio_format_) *
+                       (av_sample_fmt_is_planar(dst_audio_format_) ? 1 : channels);
+    bool reusable = dst_frame->buf[0] && av_frame_is_writable(dst_frame) &&
+                    dst_frame->format == dst_audio_format_ &&
+                    dst_frame->ch_layout.nb_channels == channels &&
+                    sample_bytes > 0 && (int)(dst_frame->buf[0]->size / sample_bytes) >= dst_nb_samples;
+    if (reusable) {
+        dst_frame->nb_samples = (int)(dst_frame->buf[0]->size / sample_bytes);
+    } else if (!getAudioBuffer(dst_frame, dst_nb_samples)) {
+        fprintf(stderr, "can not alloc audio frame buffer\n");
+        return false;
     }
     
-    int converted_samples = swr_convert(swr_ctx_,
-                                       converted_audio_frame_->data, dst_nb_samples,
-                                       (const uint8_t**)src_frame->data, src_frame->nb_samples);
+    int converted_samples;
+    if (swr_ctx_) {
+        converted_samples = swr_convert(swr_ctx_,
+                                        dst_frame->extended_data, dst_frame->nb_samples,
+                                        (const uint8_t**)src_frame->extended_data, src_frame->nb_samples);
+    } else {
+        //格式一致，只拷贝样本
+        dst_frame->nb_samples = src_frame->nb_samples;
+        converted_samples = av_frame_copy(dst_frame, src_frame) < 0 ? -1 : src_frame->nb_samples;
+    }
     
     if (converted_samples < 0) {
         fprintf(stderr, "音频重采样失败\n");
-        av_frame_free(&converted_audio_frame_);
-        return nullptr;
+        return false;
     }
     
-    converted_audio_frame_->nb_samples = converted_samples;
+    dst_frame->nb_samples = converted_samples;
+    dst_frame->sample_rate = dst_audio_sample_rate_;
     
     if (src_frame->pts != AV_NOPTS_VALUE) {
-        converted_audio_frame_->pts = av_rescale_q(src_frame->pts,
-                                                  (AVRational){1, src_frame->sample_rate},
-                                                  (AVRational){1, dst_audio_sample_rate_});
+        dst_frame->pts = av_rescale_q(src_frame->pts,
+                                      (AVRational){1, src_frame->sample_rate},
+                                      (AVRational){1, dst_audio_sample_rate_});
     }
-    return av_frame_clone(converted_audio_frame_);
+    return true;
 }
 
-void MediaFormatConverter::cleanup() {
-    if (sws_ctx_) {
-        sws_freeContext(sws_ctx_);
-        sws_ctx_ = nullptr;
+AVFrame* MediaFormatConverter::convertAudio(AVFrame* src_frame) {
+    if (!needAudioConversion(src_frame)) {
+        return av_frame_clone(src_frame);
     }
-    
-    if (converted_video_frame_) {
-        av_frame_free(&converted_video_frame_);
+    AVFrame* frame = av_frame_alloc();
+    if (!frame) {
+        return nullptr;
     }
-    
-    if (swr_ctx_) {
-        swr_free(&swr_ctx_);
+    if (!convertAudioInto(src_frame, frame)) {
+        av_frame_free(&frame);
+        return nullptr;
     }
+    return frame;
+}
+
+void MediaFormatConverter::cleanup() {
+    //上下文放回缓存，同参数的下一个转换器可以直接取用
+    releaseVideoRoute();
     
-    if (converted_audio_frame_) {
-        av_frame_free(&converted_audio_frame_);
-    }
+    //池在最后一块缓冲归还后才真正释放，已交出的帧不受影响
+    av_buffer_pool_uninit(&video_pool_);
+    
+    releaseAudioRoute();
+    
+    av_buffer_pool_uninit(&audio_pool_);
+    audio_pool_samples_ = 0;
     
     av_channel_layout_uninit(&dst_audio_layout_);
     
@@ -1,24 +1,124 @@
 #include "FrameBuffer.hpp"
-
-VideoFrameBuffer::VideoFrameBuffer(int width, int height, AVPixelFormat pix_fmt)
-    :width_(width),height_(height),pix_fmt_(pix_fmt),frame_count_(0){
+#include "SampleInterleave.hpp"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <unistd.h>
+
+VideoFrameBuffer::VideoFrameBuffer(int width, int height, AVPixelFormat pix_fmt, size_t capacity)
+    :width_(width),height_(height),pix_fmt_(pix_fmt),capacity_(std::max<size_t>(capacity,2)){
         frame_size_ = av_image_get_buffer_size(pix_fmt_,width_,height_,1);
+        //所有槽位一次性分配，运行期间内存不再增长；槽位起始按64字节对齐
+        slot_stride_ = (frame_size_ + 63) & ~(size_t)63;
+        storage_ = (uint8_t*)av_malloc(capacity_ * slot_stride_);
+        if(!storage_){
+            fprintf(stderr,"Could not allocate video ring of %zu frames\n",capacity_);
+        }
+        slots_.reset(new Slot[capacity_]);
+        for(size_t i = 0; i < capacity_ && storage_; i++){
+            slots_[i].data = storage_ + i * slot_stride_;
+        }
     }
 
 VideoFrameBuffer::~VideoFrameBuffer(){
-    clear();
+    av_freep(&storage_);
 }
 
-bool VideoFrameBuffer::addFrame(const uint8_t* frame_data,size_t data_size){
-    if(!frame_data || data_size != frame_size_){
+static uint64_t elapsedNs(std::chrono::steady_clock::time_point start){
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void updateMax(std::atomic<uint64_t>& max,uint64_t value){
+    uint64_t cur = max.load(std::memory_order_relaxed);
+    while(value > cur && !max.compare_exchange_weak(cur,value,std::memory_order_relaxed)){
+    }
+}
+
+bool VideoFrameBuffer::enableSpill(const std::string& dir,size_t max_bytes){
+    //槽位按页对齐，消费后可以整页丢弃
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t stride = (frame_size_ + page - 1) / page * page;
+    size_t count = stride > 0 ? max_bytes / stride : 0;
+    if(count == 0 || !spill_file_.open(dir,count * stride)){
         return false;
     }
+    spill_stride_ = stride;
+    spill_capacity_ = count;
+    spill_slots_.reset(new Slot[spill_capacity_]);
+    for(size_t i = 0; i < spill_capacity_; i++){
+        spill_slots_[i].data = spill_file_.data() + i * spill_stride_;
+    }
+    return true;
+}
 
-    size_t old_size = buffer_.size();
-    buffer_.resize(old_size + frame_size_);
-    memcpy(buffer_.data()+old_size,frame_data,frame_size_);
+VideoFrameBuffer::Slot* VideoFrameBuffer::locate(int64_t index){
+    Slot& slot = slotFor(index);
+    if(slot.seq.load(std::memory_order_acquire) == index){
+        return &slot;
+    }
+    //溢出区内序号递增，消费者按序取帧时通常就是队首
+    int64_t end = spill_write_.load(std::memory_order_acquire);
+    for(int64_t pos = spill_read_.load(std::memory_order_relaxed); pos < end; pos++){
+        Slot& spilled = spillSlotFor(pos);
+        int64_t seq = spilled.seq.load(std::memory_order_acquire);
+        if(seq == index){
+            return &spilled;
+        }
+        if(seq > index){
+            break;
+        }
+    }
+    return nullptr;
+}
+
+VideoFrameBuffer::Slot* VideoFrameBuffer::reserveSlot(int64_t& seq,bool& spilled){
+    int64_t w = write_count_.load(std::memory_order_relaxed);
+    int64_t r = read_index_.load(std::memory_order_acquire);
+    seq = w;
+    spilled = false;
+    //内存槽位上的帧已被消费才能覆盖
+    Slot& slot = slotFor(w);
+    if(storage_ && slot.seq.load(std::memory_order_relaxed) < r && slot.refs.load(std::memory_order_acquire) == 0){
+        return &slot;
+    }
+    //内存环满时写入溢出区，溢出区也满了才丢弃新帧，已缓存的帧不受影响
+    int64_t sw = spill_write_.load(std::memory_order_relaxed);
+    if(spill_capacity_ > 0 && sw - spill_read_.load(std::memory_order_acquire) < (int64_t)spill_capacity_){
+        spilled = true;
+        return &spillSlotFor(sw);
+    }
+    dropped_.fetch_add(1,std::memory_order_relaxed);
+    return nullptr;
+}
+
+void VideoFrameBuffer::commitSlot(Slot* slot,int64_t seq,bool spilled,uint64_t write_ns){
+    slot->stamp.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count(),std::memory_order_relaxed);
+    slot->seq.store(seq,std::memory_order_release);
+    if(spilled){
+        spill_frames_.fetch_add(1,std::memory_order_relaxed);
+        spill_write_ns_.fetch_add(write_ns,std::memory_order_relaxed);
+        updateMax(spill_write_ns_max_,write_ns);
+        spill_write_.store(spill_write_.load(std::memory_order_relaxed) + 1,std::memory_order_release);
+    }
+    write_count_.store(seq + 1,std::memory_order_release);
+    signal_.notify();
+}
 
-    frame_count_++;
+bool VideoFrameBuffer::addFrame(const uint8_t* frame_data,size_t data_size){
+    if(!frame_data || data_size != frame_size_){
+        return false;
+    }
+    int64_t seq;
+    bool spilled;
+    Slot* slot = reserveSlot(seq,spilled);
+    if(!slot){
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    memcpy(slot->data,frame_data,frame_size_);
+    commitSlot(slot,seq,spilled,spilled ? elapsedNs(start) : 0);
     return true;
 }
 
@@ -27,70 +127,268 @@ bool VideoFrameBuffer::addFrame(AVFrame* frame) {
         frame->width != width_ || frame->height != height_) {
         return false;
     }
-    
-    size_t old_size = buffer_.size();
-    buffer_.resize(old_size + frame_size_);
-    
+    int64_t seq;
+    bool spilled;
+    Slot* slot = reserveSlot(seq,spilled);
+    if(!slot){
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+
     uint8_t* dst_data[4];
     int dst_linesize[4];
     
     av_image_fill_arrays(dst_data, dst_linesize,
-                        buffer_.data() + old_size,
+                        slot->data,
                         pix_fmt_, width_, height_, 1);
     
     av_image_copy(dst_data, dst_linesize,
                   (const uint8_t**)frame->data, frame->linesize,
                   pix_fmt_, width_, height_);
     
-    frame_count_++;
+    commitSlot(slot,seq,spilled,spilled ? elapsedNs(start) : 0);
     return true;
 }
 
-bool VideoFrameBuffer::getFrame(int frame_index, uint8_t*& frame_data) {
-    if (frame_index < 0 || frame_index >= frame_count_) {
-        return false;
+void VideoFrameBuffer::pageIn(Slot* slot) {
+    //同步读一遍每页，把换页延迟留在这里统计，而不是落到编码器里
+    auto start = std::chrono::steady_clock::now();
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    volatile uint8_t sink = 0;
+    for (size_t off = 0; off < frame_size_; off += page) {
+        sink ^= slot->data[off];
     }
-    frame_data = buffer_.data() + frame_index * frame_size_;
-    return true;
+    (void)sink;
+    uint64_t ns = elapsedNs(start);
+    page_ins_.fetch_add(1, std::memory_order_relaxed);
+    page_in_ns_.fetch_add(ns, std::memory_order_relaxed);
+    updateMax(page_in_ns_max_, ns);
+
+    //顺带预读溢出区中的下一帧
+    size_t next = (size_t)(slot - spill_slots_.get() + 1) % spill_capacity_;
+    spill_file_.prefetch(next * spill_stride_, frame_size_);
+}
+
+void VideoFrameBuffer::releaseSlot(void* opaque, uint8_t*) {
+    //最后一个引用释放时调用，可能在编码器内部线程上；只归还引用计数，游标由消费者推进
+    static_cast<Slot*>(opaque)->refs.fetch_sub(1, std::memory_order_acq_rel);
 }
 
-AVFrame* VideoFrameBuffer::getAVFrame(int frame_index) {
-    uint8_t* frame_data;
-    if (!getFrame(frame_index, frame_data)) {
+AVFrame* VideoFrameBuffer::getAVFrame(int64_t frame_index) {
+    if (frame_index < read_index_.load(std::memory_order_acquire) ||
+        frame_index >= write_count_.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    //请求某一帧即表示之前的帧都已取走，仍被引用的槽位会挡住游标
+    if (frame_index > consumed_) {
+        consumed_ = frame_index;
+        advanceReadIndex();
+    }
+    Slot* slot = locate(frame_index);
+    if (!slot) {
         return nullptr;
     }
+    slot->refs.fetch_add(1, std::memory_order_acq_rel);
 
     AVFrame* frame = av_frame_alloc();
     if (!frame) {
+        slot->refs.fetch_sub(1, std::memory_order_acq_rel);
+        return nullptr;
+    }
+    //槽位包成只读的AVBufferRef，编码器可以直接av_frame_ref持有，不再拷贝整帧
+    frame->buf[0] = av_buffer_create(slot->data, frame_size_, releaseSlot, slot, AV_BUFFER_FLAG_READONLY);
+    if (!frame->buf[0]) {
+        slot->refs.fetch_sub(1, std::memory_order_acq_rel);
+        av_frame_free(&frame);
         return nullptr;
     }
+    if (slot < slots_.get() || slot >= slots_.get() + capacity_) {
+        pageIn(slot);
+    }
 
     frame->format = pix_fmt_;
     frame->width = width_;
     frame->height = height_;
+    //记录序号，releaseFrame据此推进游标
+    frame->opaque = (void*)(intptr_t)frame_index;
 
     av_image_fill_arrays(frame->data, frame->linesize,
-                        frame_data, pix_fmt_, width_, height_, 1);
+                        slot->data, pix_fmt_, width_, height_, 1);
 
     return frame;
 }
 
+bool VideoFrameBuffer::waitForFrame(int64_t frame_index, int timeout_ms) {
+    return signal_.waitFor([&]{
+        return frame_index < write_count_.load(std::memory_order_acquire);
+    }, timeout_ms);
+}
+
+int64_t VideoFrameBuffer::getEnqueueTime(int64_t frame_index) {
+    if (frame_index < read_index_.load(std::memory_order_acquire) ||
+        frame_index >= write_count_.load(std::memory_order_acquire)) {
+        return -1;
+    }
+    Slot* slot = locate(frame_index);
+    return slot ? slot->stamp.load(std::memory_order_relaxed) : -1;
+}
+
+void VideoFrameBuffer::releaseFrame(AVFrame*& frame) {
+    if (!frame) {
+        return;
+    }
+    int64_t index = (int64_t)(intptr_t)frame->opaque;
+    av_frame_free(&frame);
+    if (index + 1 > consumed_) {
+        consumed_ = index + 1;
+    }
+    advanceReadIndex();
+}
+
+void VideoFrameBuffer::advanceReadIndex() {
+    int64_t r = read_index_.load(std::memory_order_relaxed);
+    while (r < consumed_) {
+        Slot* slot = locate(r);
+        if (slot && slot->refs.load(std::memory_order_acquire) > 0) {
+            break;
+        }
+        r++;
+    }
+    read_index_.store(r, std::memory_order_release);
+
+    //已消费的溢出槽位交还生产者，对应页面直接丢弃，不再回写磁盘
+    int64_t sr = spill_read_.load(std::memory_order_relaxed);
+    int64_t sw = spill_write_.load(std::memory_order_acquire);
+    while (sr < sw && spillSlotFor(sr).seq.load(std::memory_order_acquire) < r) {
+        spill_file_.discard((size_t)(sr % (int64_t)spill_capacity_) * spill_stride_, spill_stride_);
+        sr++;
+    }
+    spill_read_.store(sr, std::memory_order_release);
+}
+
+size_t VideoFrameBuffer::getBufferedFrames() const {
+    return (size_t)(write_count_.load(std::memory_order_acquire) - read_index_.load(std::memory_order_acquire));
+}
+
+size_t VideoFrameBuffer::getSpilledFrames() const {
+    return (size_t)(spill_write_.load(std::memory_order_acquire) - spill_read_.load(std::memory_order_acquire));
+}
+
+SpillStats VideoFrameBuffer::getSpillStats() const {
+    SpillStats stats;
+    stats.frames = spill_frames_.load(std::memory_order_relaxed);
+    stats.bytes = stats.frames * frame_size_;
+    stats.pending_frames = getSpilledFrames();
+    stats.write_ns_total = spill_write_ns_.load(std::memory_order_relaxed);
+    stats.write_ns_max = spill_write_ns_max_.load(std::memory_order_relaxed);
+    stats.page_ins = page_ins_.load(std::memory_order_relaxed);
+    stats.page_in_ns_total = page_in_ns_.load(std::memory_order_relaxed);
+    stats.page_in_ns_max = page_in_ns_max_.load(std::memory_order_relaxed);
+    return stats;
+}
+
 void VideoFrameBuffer::clear() {
-    buffer_.clear();
-    frame_count_ = 0;
+    for (size_t i = 0; i < capacity_; i++) {
+        slots_[i].refs.store(0);
+        slots_[i].seq.store(-1);
+    }
+    for (size_t i = 0; i < spill_capacity_; i++) {
+        spill_slots_[i].refs.store(0);
+        spill_slots_[i].seq.store(-1);
+    }
+    write_count_.store(0);
+    read_index_.store(0);
+    spill_write_.store(0);
+    spill_read_.store(0);
+    consumed_ = 0;
 }
 
-AudioFrameBuffer::AudioFrameBuffer(int sample_rate, int channels, AVSampleFormat sample_fmt)
-    : sample_rate_(sample_rate), channels_(channels), sample_fmt_(sample_fmt), total_samples_(0) {
+AudioFrameBuffer::AudioFrameBuffer(int sample_rate, int channels, AVSampleFormat sample_fmt, size_t capacity_samples)
+    : sample_rate_(sample_rate), channels_(channels), sample_fmt_(sample_fmt) {
     bytes_per_sample_ = av_get_bytes_per_sample(sample_fmt_);
+    planar_ = av_sample_fmt_is_planar(sample_fmt_);
+    planes_ = planar_ ? channels_ : 1;
+    plane_sample_bytes_ = planar_ ? bytes_per_sample_ : bytes_per_sample_ * channels_;
+    capacity_ = capacity_samples > 0 ? capacity_samples : (size_t)std::max(sample_rate_, 1) * 2;
+    storage_.resize((size_t)planes_ * capacity_ * plane_sample_bytes_);
+    for (int p = 0; p < planes_; p++) {
+        rings_.push_back(storage_.data() + (size_t)p * capacity_ * plane_sample_bytes_);
+    }
+    write_ptrs_.resize(planes_);
+    low_watermark_ = capacity_ / 4;
+    high_watermark_ = capacity_ * 3 / 4;
 }
 
 AudioFrameBuffer::~AudioFrameBuffer() {
-    clear();
+}
+
+size_t AudioFrameBuffer::getFillLevel() const {
+    return (size_t)(write_pos_.load(std::memory_order_acquire) - read_pos_.load(std::memory_order_acquire));
+}
+
+void AudioFrameBuffer::copyIn(const uint8_t* const* src, int64_t pos, int nb_samples) {
+    //环尾不够时分两段拷贝
+    size_t offset = (size_t)(pos % (int64_t)capacity_);
+    size_t first = std::min((size_t)nb_samples, capacity_ - offset);
+    for (int p = 0; p < planes_; p++) {
+        memcpy(rings_[p] + offset * plane_sample_bytes_, src[p], first * plane_sample_bytes_);
+        if (first < (size_t)nb_samples) {
+            memcpy(rings_[p], src[p] + first * plane_sample_bytes_, (nb_samples - first) * plane_sample_bytes_);
+        }
+    }
+}
+
+void AudioFrameBuffer::copyOut(uint8_t* const* dst, int64_t pos, int nb_samples) const {
+    size_t offset = (size_t)(pos % (int64_t)capacity_);
+    size_t first = std::min((size_t)nb_samples, capacity_ - offset);
+    for (int p = 0; p < planes_; p++) {
+        memcpy(dst[p], rings_[p] + offset * plane_sample_bytes_, first * plane_sample_bytes_);
+        if (first < (size_t)nb_samples) {
+            memcpy(dst[p] + first * plane_sample_bytes_, rings_[p], (nb_samples - first) * plane_sample_bytes_);
+        }
+    }
+}
+
+bool AudioFrameBuffer::reserve(int nb_samples) {
+    //空间不足时整帧丢弃，保证已缓存的样本连续
+    if (nb_samples <= 0 || getFillLevel() + (size_t)nb_samples > capacity_) {
+        overflow_samples_.fetch_add(nb_samples > 0 ? nb_samples : 0, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void AudioFrameBuffer::commit(int nb_samples) {
+    int64_t w = write_pos_.load(std::memory_order_relaxed) + nb_samples;
+    write_pos_.store(w, std::memory_order_release);
+    size_t fill = (size_t)(w - read_pos_.load(std::memory_order_acquire));
+    if (fill > peak_fill_.load(std::memory_order_relaxed)) {
+        peak_fill_.store(fill, std::memory_order_relaxed);
+    }
+    signal_.notify();
 }
 
 bool AudioFrameBuffer::addFrame(const uint8_t* samples_data,int nb_samples){
-    printf("pause use");
+    if (!samples_data || !reserve(nb_samples)) {
+        return false;
+    }
+    int64_t w = write_pos_.load(std::memory_order_relaxed);
+    if (!planar_) {
+        copyIn(&samples_data, w, nb_samples);
+    } else {
+        //交错输入拆到各声道的环，环尾处分两段
+        size_t offset = (size_t)(w % (int64_t)capacity_);
+        int first = (int)std::min((size_t)nb_samples, capacity_ - offset);
+        for (int ch = 0; ch < channels_; ch++) {
+            write_ptrs_[ch] = rings_[ch] + offset * bytes_per_sample_;
+        }
+        SampleInterleave::deinterleave(write_ptrs_.data(), samples_data, channels_, first, bytes_per_sample_);
+        if (first < nb_samples) {
+            SampleInterleave::deinterleave(rings_.data(), samples_data + (size_t)first * channels_ * bytes_per_sample_,
+                                           channels_, nb_samples - first, bytes_per_sample_);
+        }
+    }
+    commit(nb_samples);
     return true;
 }
 
@@ -99,35 +397,39 @@ bool AudioFrameBuffer::addFrame(AVFrame* frame){
         frame->format != sample_fmt_ || frame->ch_layout.nb_channels != channels_) {
         return false;
     }
-
-    size_t bytes_per_sample = av_get_bytes_per_sample((AVSampleFormat)sample_fmt_);
-    bool planar = av_sample_fmt_is_planar((AVSampleFormat)sample_fmt_);
-
-    for (int i = 0; i < frame->nb_samples; ++i) {
-        for (int ch = 0; ch < channels_; ++ch) {
-            const uint8_t* src;
-            if (planar) {
-                src = frame->data[ch] + i * bytes_per_sample;
-            } else {
-                src = frame->data[0] + (i * channels_ + ch) * bytes_per_sample;
-            }
-            buffer_.insert(buffer_.end(), src, src + bytes_per_sample);
-        }
+    if (!reserve(frame->nb_samples)) {
+        return false;
     }
-
-    total_samples_ += frame->nb_samples;
+    copyIn(frame->extended_data, write_pos_.load(std::memory_order_relaxed), frame->nb_samples);
+    commit(frame->nb_samples);
     return true;
 }
 
-bool AudioFrameBuffer::getSamples(int start_sample, int nb_samples, uint8_t*& sample_data) {
-    printf("pause use");
+bool AudioFrameBuffer::readSamples(uint8_t* const* dst, int nb_samples) {
+    int64_t r = read_pos_.load(std::memory_order_relaxed);
+    if (nb_samples <= 0 || write_pos_.load(std::memory_order_acquire) - r < nb_samples) {
+        return false;
+    }
+    copyOut(dst, r, nb_samples);
+    read_pos_.store(r + nb_samples, std::memory_order_release);
     return true;
 }
 
-AVFrame* AudioFrameBuffer::getAVFrame(int start_sample, int nb_samples) {
-   if (start_sample < 0 || start_sample + nb_samples > total_samples_) {
+bool AudioFrameBuffer::waitForSamples(int64_t start_sample, int nb_samples, int timeout_ms) {
+    return signal_.waitFor([&]{
+        return start_sample + nb_samples <= write_pos_.load(std::memory_order_acquire);
+    }, timeout_ms);
+}
+
+AVFrame* AudioFrameBuffer::getAVFrame(int64_t start_sample, int nb_samples) {
+    int64_t r = read_pos_.load(std::memory_order_relaxed);
+    int64_t w = write_pos_.load(std::memory_order_acquire);
+    if (nb_samples <= 0 || start_sample < r || start_sample + nb_samples > w) {
         return nullptr;
     }
+    if (start_sample > r) {
+        read_pos_.store(start_sample, std::memory_order_release);
+    }
 
     AVFrame* frame = av_frame_alloc();
     if (!frame) return nullptr;
@@ -142,43 +444,90 @@ AVFrame* AudioFrameBuffer::getAVFrame(int start_sample, int nb_samples) {
         return nullptr;
     }
 
-    size_t bytes_per_sample = av_get_bytes_per_sample((AVSampleFormat)sample_fmt_);
-    bool planar = av_sample_fmt_is_planar((AVSampleFormat)sample_fmt_);
-
-    const uint8_t* src = buffer_.data() + 
-                         start_sample * channels_ * bytes_per_sample;
-
-    if (planar) {
-        for (int i = 0; i < nb_samples; ++i) {
-            for (int ch = 0; ch < channels_; ++ch) {
-                const uint8_t* sample_ptr = src + (i * channels_ + ch) * bytes_per_sample;
-                memcpy(frame->data[ch] + i * bytes_per_sample,
-                       sample_ptr, bytes_per_sample);
-            }
-        }
-    } else {
-        size_t data_size = nb_samples * channels_ * bytes_per_sample;
-        memcpy(frame->data[0], src, data_size);
+    if (!readSamples(frame->extended_data, nb_samples)) {
+        av_frame_free(&frame);
+        return nullptr;
     }
-
     return frame;
 }
 
 void AudioFrameBuffer::clear() {
-    buffer_.clear();
-    total_samples_ = 0;
+    write_pos_.store(0);
+    read_pos_.store(0);
+    peak_fill_.store(0);
 }
 
-bool MediaDataManager::initVideoBuffer(int width, int height, AVPixelFormat pix_fmt) {
-    video_buffer_ = std::make_unique<VideoFrameBuffer>(width, height, pix_fmt);
+bool MediaDataManager::initVideoBuffer(int width, int height, AVPixelFormat pix_fmt, size_t capacity) {
+    if (budget_.max_resident_bytes > 0) {
+        //音频环已建好时按实际占用扣除，否则预留音频份额
+        size_t audio_bytes = audio_buffer_ ? audio_buffer_->getCapacityBytes()
+                                           : (size_t)(budget_.max_resident_bytes * budget_.audio_share);
+        size_t video_bytes = budget_.max_resident_bytes > audio_bytes ? budget_.max_resident_bytes - audio_bytes : 0;
+        size_t frame_size = (size_t)std::max(av_image_get_buffer_size(pix_fmt, width, height, 1), 1);
+        size_t fit = std::max<size_t>(video_bytes / ((frame_size + 63) & ~(size_t)63), 2);
+        if (fit < capacity) {
+            capacity = fit;
+        }
+    }
+    video_buffer_ = std::make_unique<VideoFrameBuffer>(width, height, pix_fmt, capacity);
+    if (budget_.max_spill_bytes > 0 && !video_buffer_->enableSpill(budget_.spill_dir, budget_.max_spill_bytes)) {
+        fprintf(stderr, "video spill disabled, frames over budget will be dropped\n");
+    }
     return video_buffer_ != nullptr;
 }
 
-bool MediaDataManager::initAudioBuffer(int sample_rate, int channels, AVSampleFormat sample_fmt) {
-    audio_buffer_ = std::make_unique<AudioFrameBuffer>(sample_rate, channels, sample_fmt);
+bool MediaDataManager::initAudioBuffer(int sample_rate, int channels, AVSampleFormat sample_fmt, size_t capacity_samples) {
+    if (budget_.max_resident_bytes > 0) {
+        size_t sample_bytes = (size_t)std::max(channels * av_get_bytes_per_sample(sample_fmt), 1);
+        size_t share = (size_t)(budget_.max_resident_bytes * budget_.audio_share);
+        //未指定容量时默认2秒，预算不够时压到预算内，但至少保留100ms
+        size_t wanted = capacity_samples > 0 ? capacity_samples : (size_t)std::max(sample_rate, 1) * 2;
+        size_t floor = (size_t)std::max(sample_rate / 10, 1);
+        capacity_samples = std::max(std::min(wanted, share / sample_bytes), floor);
+    }
+    audio_buffer_ = std::make_unique<AudioFrameBuffer>(sample_rate, channels, sample_fmt, capacity_samples);
     return audio_buffer_ != nullptr;
 }
 
+MemoryStats MediaDataManager::getMemoryStats() const {
+    MemoryStats stats;
+    stats.budget_bytes = budget_.max_resident_bytes;
+    if (video_buffer_) {
+        SpillStats spill = video_buffer_->getSpillStats();
+        size_t frame_size = video_buffer_->getFrameSize();
+        size_t buffered = video_buffer_->getBufferedFrames();
+        size_t resident_frames = buffered > spill.pending_frames ? buffered - spill.pending_frames : 0;
+        stats.reserved_bytes += video_buffer_->getCapacityBytes();
+        stats.resident_bytes += resident_frames * frame_size;
+        stats.spilled_bytes = spill.pending_frames * frame_size;
+        stats.spilled_total_bytes = spill.bytes;
+        stats.dropped_video_frames = video_buffer_->getDroppedFrames();
+        if (spill.frames > 0) {
+            stats.spill_write_avg_us = spill.write_ns_total / 1000.0 / spill.frames;
+        }
+        stats.spill_write_max_us = spill.write_ns_max / 1000.0;
+        if (spill.page_ins > 0) {
+            stats.page_in_avg_us = spill.page_in_ns_total / 1000.0 / spill.page_ins;
+        }
+        stats.page_in_max_us = spill.page_in_ns_max / 1000.0;
+    }
+    if (audio_buffer_) {
+        stats.reserved_bytes += audio_buffer_->getCapacityBytes();
+        stats.resident_bytes += audio_buffer_->getBufferedBytes();
+        stats.overflow_audio_samples = audio_buffer_->getOverflowSamples();
+    }
+    return stats;
+}
+
+void MediaDataManager::wakeConsumers() {
+    if (video_buffer_) {
+        video_buffer_->wakeConsumers();
+    }
+    if (audio_buffer_) {
+        audio_buffer_->wakeConsumers();
+    }
+}
+
 void MediaDataManager::clearAll() {
     if (video_buffer_) {
         video_buffer_->clear();
@@ -0,0 +1,110 @@
+#include "KeyframeIndex.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+static const int KIDX_VERSION = 1;
+
+bool KeyframeIndex::build(AVFormatContext* fmt_ctx){
+    if(!fmt_ctx){
+        return false;
+    }
+    streams_.clear();
+
+    //只索引视频流，其余流在扫描期间丢弃以减少解析
+    std::vector<AVDiscard> saved_discard(fmt_ctx->nb_streams);
+    for(unsigned int i = 0; i < fmt_ctx->nb_streams; i++){
+        AVStream* st = fmt_ctx->streams[i];
+        saved_discard[i] = st->discard;
+        if(st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO){
+            streams_[i];
+        }else{
+            st->discard = AVDISCARD_ALL;
+        }
+    }
+
+    AVPacket* pkt = av_packet_alloc();
+    if(!pkt){
+        fprintf(stderr,"Could not allocate packet\n");
+        return false;
+    }
+    while(av_read_frame(fmt_ctx,pkt) >= 0){
+        auto it = streams_.find(pkt->stream_index);
+        if(it != streams_.end() && (pkt->flags & AV_PKT_FLAG_KEY)){
+            int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+            if(ts != AV_NOPTS_VALUE){
+                it->second.push_back({ts,pkt->pos});
+            }
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+
+    for(unsigned int i = 0; i < fmt_ctx->nb_streams; i++){
+        fmt_ctx->streams[i]->discard = saved_discard[i];
+    }
+    for(auto& kv : streams_){
+        std::sort(kv.second.begin(),kv.second.end(),
+                  [](const Entry& a,const Entry& b){ return a.pts < b.pts; });
+    }
+    return true;
+}
+
+bool KeyframeIndex::load(const std::string& path,int64_t file_size,int64_t mtime){
+    FILE* f = fopen(path.c_str(),"r");
+    if(!f){
+        return false;
+    }
+    int version = 0;
+    int64_t saved_size = 0,saved_mtime = 0;
+    if(fscanf(f,"KIDX %d %" SCNd64 " %" SCNd64,&version,&saved_size,&saved_mtime) != 3 ||
+       version != KIDX_VERSION || saved_size != file_size || saved_mtime != mtime){
+        //sidecar过期或格式不符，交给调用方重建
+        fclose(f);
+        return false;
+    }
+
+    streams_.clear();
+    int stream_index;
+    Entry e;
+    while(fscanf(f,"%d %" SCNd64 " %" SCNd64,&stream_index,&e.pts,&e.pos) == 3){
+        streams_[stream_index].push_back(e);
+    }
+    fclose(f);
+    return !streams_.empty();
+}
+
+bool KeyframeIndex::save(const std::string& path,int64_t file_size,int64_t mtime) const{
+    FILE* f = fopen(path.c_str(),"w");
+    if(!f){
+        fprintf(stderr,"Could not write keyframe index %s\n",path.c_str());
+        return false;
+    }
+    fprintf(f,"KIDX %d %" PRId64 " %" PRId64 "\n",KIDX_VERSION,file_size,mtime);
+    for(const auto& kv : streams_){
+        for(const Entry& e : kv.second){
+            fprintf(f,"%d %" PRId64 " %" PRId64 "\n",kv.first,e.pts,e.pos);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+const KeyframeIndex::Entry* KeyframeIndex::lookup(int stream_index,int64_t pts) const{
+    auto it = streams_.find(stream_index);
+    if(it == streams_.end() || it->second.empty()){
+        return nullptr;
+    }
+    const std::vector<Entry>& v = it->second;
+    auto pos = std::upper_bound(v.begin(),v.end(),pts,
+                                [](int64_t t,const Entry& e){ return t < e.pts; });
+    if(pos == v.begin()){
+        return &v.front();
+    }
+    return &*(pos - 1);
+}
+
+const std::vector<KeyframeIndex::Entry>* KeyframeIndex::entries(int stream_index) const{
+    auto it = streams_.find(stream_index);
+    return it == streams_.end() ? nullptr : &it->second;
+}
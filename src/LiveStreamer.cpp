@@ -114,9 +114,10 @@ bool LiverStreamer::configure(const Config& config){
 bool LiverStreamer::initializeComponents(){
     int ret;
     data_manager_ = std::make_unique<MediaDataManager>();
+    data_manager_->setMemoryBudget(config_.memory_budget);
     //Buffer format setup, needs to be converted to a format supported by the encoder
     data_manager_->initAudioBuffer(config_.audio_sample_rate,config_.audio_channels,get_default_sample_fmt(config_.audio_codec));
-    data_manager_->initVideoBuffer(config_.video_width,config_.video_height,config_.video_fmt);
+    data_manager_->initVideoBuffer(config_.video_width,config_.video_height,config_.video_fmt,config_.video_buffer_frames);
 
     audio_formatConverter_ = std::make_unique<MediaFormatConverter>();
     // Data source format, manually specified
@@ -128,6 +129,9 @@ bool LiverStreamer::initializeComponents(){
     video_source_ = std::make_unique<RawFileDataSource>(config_.video_file,RawFileDataSource::FileType::YUV_FILE);
     video_source_->setYUVParams(config_.video_width ,config_.video_height ,AV_PIX_FMT_YUV420P,config_.video_fps);
     video_source_->setDataManager(data_manager_.get());
+    //源文件固定为YUV420P，缓冲格式不同时由转换器转换
+    video_formatConverter_ = std::make_unique<MediaFormatConverter>();
+    video_source_->setFormatConverter(video_formatConverter_.get());
 
 
     audio_encoder_ = std::make_unique<AudioEncoder>();
@@ -161,6 +165,13 @@ bool LiverStreamer::initializeComponents(){
     audio_formatConverter_->initAudioConverter(config_.audio_fmt,config_.audio_sample_rate,src_layout,
                                             get_default_sample_fmt(config_.audio_codec), config_.audio_sample_rate ,dst_layout );
 
+    AVPixelFormat src_pix_fmt = AV_PIX_FMT_YUV420P;
+    if(!video_formatConverter_->initVideoConverter(config_.video_width,config_.video_height,src_pix_fmt,
+                                                   config_.video_width,config_.video_height,config_.video_fmt)){
+        fprintf(stderr,"failed to init video converter");
+        return false;
+    }
+
     muxer_->addAudioStream(audio_encoder_->getCodecParameters());
     muxer_->addVideoStream(video_encoder_->getCodecParameters());
 
@@ -170,6 +181,7 @@ bool LiverStreamer::initializeComponents(){
     coordinator_->setVideoEncoder(video_encoder_.get());
     coordinator_->setMuxer(muxer_.get());
     coordinator_->setAudioVideoSync(config_.enable_av_sync);
+    coordinator_->setFrameDropConfig(config_.frame_drop);
 
     publisher_=std::make_unique<StreamPublisher>();
     publisher_->configure(config_.rtmp_url);
@@ -215,4 +227,12 @@ void LiverStreamer::stop(){
     if(muxer_) muxer_->finalize();
 
     if(publisher_) publisher_->stop();
+
+    if(data_manager_ && (config_.memory_budget.max_resident_bytes > 0 || config_.memory_budget.max_spill_bytes > 0)){
+        MemoryStats stats = data_manager_->getMemoryStats();
+        printf("[memory] reserved %zu of %zu bytes, spilled %llu bytes total (write avg %.1fus max %.1fus, page-in avg %.1fus max %.1fus), %llu video frames dropped\n",
+               stats.reserved_bytes,stats.budget_bytes,(unsigned long long)stats.spilled_total_bytes,
+               stats.spill_write_avg_us,stats.spill_write_max_us,stats.page_in_avg_us,stats.page_in_max_us,
+               (unsigned long long)stats.dropped_video_frames);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "PacketPool.hpp"
+#include <cstdio>
+#include <algorithm>
+
+PacketPool& PacketPool::instance(){
+    static PacketPool pool;
+    return pool;
+}
+
+PacketPool::~PacketPool(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(AVPacket*& pkt : free_list_){
+        av_packet_free(&pkt);
+    }
+    free_list_.clear();
+}
+
+PacketPool::ThreadCache::~ThreadCache(){
+    //线程退出时把缓存交还全局链表，供其他线程继续使用
+    PacketPool::instance().returnToGlobal(packets,0);
+}
+
+PacketPool::ThreadCache& PacketPool::threadCache(){
+    thread_local ThreadCache cache;
+    return cache;
+}
+
+void PacketPool::setLimits(size_t per_thread,size_t global){
+    thread_cache_limit_ = per_thread;
+    global_limit_ = global;
+}
+
+AVPacket* PacketPool::acquire(){
+    ThreadCache& tc = threadCache();
+    if(tc.packets.empty()){
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t batch = std::min(free_list_.size(),thread_cache_limit_.load() / 2 + 1);
+        tc.packets.insert(tc.packets.end(),free_list_.end() - batch,free_list_.end());
+        free_list_.resize(free_list_.size() - batch);
+    }
+    if(!tc.packets.empty()){
+        AVPacket* pkt = tc.packets.back();
+        tc.packets.pop_back();
+        hits_++;
+        return pkt;
+    }
+    misses_++;
+    AVPacket* pkt = av_packet_alloc();
+    if(!pkt){
+        fprintf(stderr,"Could not allocate packet\n");
+    }
+    return pkt;
+}
+
+void PacketPool::release(AVPacket*& pkt){
+    if(!pkt){
+        return;
+    }
+    av_packet_unref(pkt);
+    releases_++;
+    ThreadCache& tc = threadCache();
+    tc.packets.push_back(pkt);
+    pkt = nullptr;
+    if(tc.packets.size() > thread_cache_limit_){
+        returnToGlobal(tc.packets,thread_cache_limit_ / 2);
+    }
+}
+
+void PacketPool::returnToGlobal(std::vector<AVPacket*>& packets,size_t keep){
+    std::lock_guard<std::mutex> lock(mutex_);
+    while(packets.size() > keep){
+        AVPacket* pkt = packets.back();
+        packets.pop_back();
+        if(free_list_.size() < global_limit_){
+            free_list_.push_back(pkt);
+        }else{
+            av_packet_free(&pkt);
+        }
+    }
+}
+
+PacketPool::Stats PacketPool::getStats() const{
+    Stats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.releases = releases_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.global_free = free_list_.size();
+    return stats;
+}
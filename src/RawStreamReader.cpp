@@ -0,0 +1,129 @@
+#include "RawStreamReader.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+RawStreamReader::RawStreamReader(size_t window_size){
+    //窗口按页对齐，保证每次映射的文件偏移合法
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    window_size_ = std::max(window_size,page);
+    window_size_ = (window_size_ + page - 1) / page * page;
+}
+
+RawStreamReader::~RawStreamReader(){
+    close();
+}
+
+bool RawStreamReader::open(const std::string& path){
+    close();
+    if(path == "-" || path == "pipe:"){
+        fd_ = 0;
+    }else{
+        fd_ = ::open(path.c_str(),O_RDONLY);
+        owns_fd_ = true;
+    }
+    if(fd_ < 0){
+        fprintf(stderr,"could not open source file %s\n",path.c_str());
+        return false;
+    }
+    struct stat st;
+    mapped_ = fstat(fd_,&st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0;
+    file_size_ = mapped_ ? (uint64_t)st.st_size : 0;
+    if(mapped_){
+        posix_fadvise(fd_,0,0,POSIX_FADV_SEQUENTIAL);
+    }
+    return true;
+}
+
+void RawStreamReader::unmapWindow(){
+    if(map_){
+        munmap(map_,map_len_);
+        map_ = nullptr;
+        map_len_ = 0;
+    }
+}
+
+void RawStreamReader::close(){
+    unmapWindow();
+    if(owns_fd_ && fd_ >= 0){
+        ::close(fd_);
+    }
+    fd_ = -1;
+    owns_fd_ = false;
+    mapped_ = false;
+    file_size_ = 0;
+    offset_ = 0;
+    error_ = 0;
+}
+
+bool RawStreamReader::next(uint8_t*& data,size_t& size){
+    unmapWindow();
+    if(fd_ < 0){
+        return false;
+    }
+
+    if(!mapped_){
+        buffer_.resize(window_size_ + AV_INPUT_BUFFER_PADDING_SIZE);
+        ssize_t n;
+        do{
+            n = ::read(fd_,buffer_.data(),window_size_);
+        }while(n < 0 && errno == EINTR);
+        if(n <= 0){
+            if(n < 0){
+                error_ = errno;
+                fprintf(stderr,"Error reading input file: %s\n",strerror(error_));
+            }
+            return false;
+        }
+        memset(buffer_.data() + n,0,AV_INPUT_BUFFER_PADDING_SIZE);
+        data = buffer_.data();
+        size = (size_t)n;
+        offset_ += (uint64_t)n;
+        return true;
+    }
+
+    if(offset_ >= file_size_){
+        return false;
+    }
+    size_t len = (size_t)std::min<uint64_t>(window_size_,file_size_ - offset_);
+    //中间窗口多映射一段padding，内容是下一窗口的真实数据；末窗口拷贝出来补零
+    if(offset_ + len + AV_INPUT_BUFFER_PADDING_SIZE <= file_size_){
+        void* p = mmap(nullptr,len + AV_INPUT_BUFFER_PADDING_SIZE,PROT_READ,MAP_PRIVATE,fd_,(off_t)offset_);
+        if(p == MAP_FAILED){
+            error_ = errno;
+            fprintf(stderr,"could not mmap source window: %s\n",strerror(error_));
+            return false;
+        }
+        map_ = (uint8_t*)p;
+        map_len_ = len + AV_INPUT_BUFFER_PADDING_SIZE;
+        madvise(map_,map_len_,MADV_SEQUENTIAL);
+        //提前让内核读入下一窗口
+        posix_fadvise(fd_,(off_t)(offset_ + len),(off_t)window_size_,POSIX_FADV_WILLNEED);
+        data = map_;
+    }else{
+        buffer_.assign(len + AV_INPUT_BUFFER_PADDING_SIZE,0);
+        size_t done = 0;
+        while(done < len){
+            ssize_t n = pread(fd_,buffer_.data() + done,len - done,(off_t)(offset_ + done));
+            if(n < 0 && errno == EINTR){
+                continue;
+            }
+            //文件在读取期间被截断也按错误处理
+            if(n <= 0){
+                error_ = n < 0 ? errno : EIO;
+                fprintf(stderr,"Error reading input file: %s\n",strerror(error_));
+                return false;
+            }
+            done += (size_t)n;
+        }
+        data = buffer_.data();
+    }
+    size = len;
+    offset_ += len;
+    return true;
+}
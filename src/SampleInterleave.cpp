@@ -0,0 +1,701 @@
+#include "SampleInterleave.hpp"
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define SAMPLE_INTERLEAVE_X86 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SAMPLE_INTERLEAVE_NEON 1
+#endif
+
+namespace {
+
+//标量版本：声道数作为模板参数，内层循环可完全展开
+template<typename T,int C>
+void interleaveN(T* dst,const T* const* src,int n){
+    for(int i = 0; i < n; i++){
+        for(int c = 0; c < C; c++){
+            dst[i * C + c] = src[c][i];
+        }
+    }
+}
+
+template<typename T,int C>
+void deinterleaveN(T* const* dst,const T* src,int n){
+    for(int i = 0; i < n; i++){
+        for(int c = 0; c < C; c++){
+            dst[c][i] = src[i * C + c];
+        }
+    }
+}
+
+template<typename T>
+void interleaveT(uint8_t* dst,const uint8_t* const* src,int channels,int n){
+    const T* s[8];
+    for(int c = 0; c < channels && c < 8; c++){
+        s[c] = reinterpret_cast<const T*>(src[c]);
+    }
+    T* d = reinterpret_cast<T*>(dst);
+    switch(channels){
+        case 1: interleaveN<T,1>(d,s,n); return;
+        case 2: interleaveN<T,2>(d,s,n); return;
+        case 3: interleaveN<T,3>(d,s,n); return;
+        case 4: interleaveN<T,4>(d,s,n); return;
+        case 5: interleaveN<T,5>(d,s,n); return;
+        case 6: interleaveN<T,6>(d,s,n); return;
+        case 7: interleaveN<T,7>(d,s,n); return;
+        case 8: interleaveN<T,8>(d,s,n); return;
+    }
+    for(int i = 0; i < n; i++){
+        for(int c = 0; c < channels; c++){
+            d[(size_t)i * channels + c] = reinterpret_cast<const T*>(src[c])[i];
+        }
+    }
+}
+
+template<typename T>
+void deinterleaveT(uint8_t* const* dst,const uint8_t* src,int channels,int n){
+    T* d[8];
+    for(int c = 0; c < channels && c < 8; c++){
+        d[c] = reinterpret_cast<T*>(dst[c]);
+    }
+    const T* s = reinterpret_cast<const T*>(src);
+    switch(channels){
+        case 1: deinterleaveN<T,1>(d,s,n); return;
+        case 2: deinterleaveN<T,2>(d,s,n); return;
+        case 3: deinterleaveN<T,3>(d,s,n); return;
+        case 4: deinterleaveN<T,4>(d,s,n); return;
+        case 5: deinterleaveN<T,5>(d,s,n); return;
+        case 6: deinterleaveN<T,6>(d,s,n); return;
+        case 7: deinterleaveN<T,7>(d,s,n); return;
+        case 8: deinterleaveN<T,8>(d,s,n); return;
+    }
+    for(int i = 0; i < n; i++){
+        for(int c = 0; c < channels; c++){
+            reinterpret_cast<T*>(dst[c])[i] = s[(size_t)i * channels + c];
+        }
+    }
+}
+
+//双声道SIMD内核：处理整块后剩余的样本交给标量版本
+typedef void (*InterleaveStereo)(uint8_t* dst,const uint8_t* l,const uint8_t* r,int n);
+typedef void (*DeinterleaveStereo)(uint8_t* l,uint8_t* r,const uint8_t* src,int n);
+
+template<typename T>
+void interleaveTail(uint8_t* dst,const uint8_t* l,const uint8_t* r,int from,int n){
+    const uint8_t* src[2] = {l + (size_t)from * sizeof(T),r + (size_t)from * sizeof(T)};
+    interleaveT<T>(dst + (size_t)from * 2 * sizeof(T),src,2,n - from);
+}
+
+template<typename T>
+void deinterleaveTail(uint8_t* l,uint8_t* r,const uint8_t* src,int from,int n){
+    uint8_t* dst[2] = {l + (size_t)from * sizeof(T),r + (size_t)from * sizeof(T)};
+    deinterleaveT<T>(dst,src + (size_t)from * 2 * sizeof(T),2,n - from);
+}
+
+//多声道SIMD内核：6/8声道，对应5.1/7.1
+typedef void (*InterleaveMulti)(uint8_t* dst,const uint8_t* const* src,int n);
+typedef void (*DeinterleaveMulti)(uint8_t* const* dst,const uint8_t* src,int n);
+
+template<typename T,int C>
+void interleaveTailN(uint8_t* dst,const uint8_t* const* src,int from,int n){
+    const uint8_t* s[C];
+    for(int c = 0; c < C; c++){
+        s[c] = src[c] + (size_t)from * sizeof(T);
+    }
+    interleaveT<T>(dst + (size_t)from * C * sizeof(T),s,C,n - from);
+}
+
+template<typename T,int C>
+void deinterleaveTailN(uint8_t* const* dst,const uint8_t* src,int from,int n){
+    uint8_t* d[C];
+    for(int c = 0; c < C; c++){
+        d[c] = dst[c] + (size_t)from * sizeof(T);
+    }
+    deinterleaveT<T>(d,src + (size_t)from * C * sizeof(T),C,n - from);
+}
+
+#ifdef SAMPLE_INTERLEAVE_X86
+__attribute__((target("sse2")))
+void interleave16x2Sse2(uint8_t* dst,const uint8_t* l,const uint8_t* r,int n){
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m128i a = _mm_loadu_si128((const __m128i*)(l + i * 2));
+        __m128i b = _mm_loadu_si128((const __m128i*)(r + i * 2));
+        _mm_storeu_si128((__m128i*)(dst + i * 4),_mm_unpacklo_epi16(a,b));
+        _mm_storeu_si128((__m128i*)(dst + i * 4 + 16),_mm_unpackhi_epi16(a,b));
+    }
+    interleaveTail<uint16_t>(dst,l,r,i,n);
+}
+
+__attribute__((target("sse2")))
+void interleave32x2Sse2(uint8_t* dst,const uint8_t* l,const uint8_t* r,int n){
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m128i a = _mm_loadu_si128((const __m128i*)(l + i * 4));
+        __m128i b = _mm_loadu_si128((const __m128i*)(r + i * 4));
+        _mm_storeu_si128((__m128i*)(dst + i * 8),_mm_unpacklo_epi32(a,b));
+        _mm_storeu_si128((__m128i*)(dst + i * 8 + 16),_mm_unpackhi_epi32(a,b));
+    }
+    interleaveTail<uint32_t>(dst,l,r,i,n);
+}
+
+__attribute__((target("sse2")))
+void deinterleave16x2Sse2(uint8_t* l,uint8_t* r,const uint8_t* src,int n){
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m128i x0 = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i x1 = _mm_loadu_si128((const __m128i*)(src + i * 4 + 16));
+        //低16位符号扩展后再饱和打包，数值不变
+        __m128i l0 = _mm_srai_epi32(_mm_slli_epi32(x0,16),16);
+        __m128i l1 = _mm_srai_epi32(_mm_slli_epi32(x1,16),16);
+        __m128i r0 = _mm_srai_epi32(x0,16);
+        __m128i r1 = _mm_srai_epi32(x1,16);
+        _mm_storeu_si128((__m128i*)(l + i * 2),_mm_packs_epi32(l0,l1));
+        _mm_storeu_si128((__m128i*)(r + i * 2),_mm_packs_epi32(r0,r1));
+    }
+    deinterleaveTail<uint16_t>(l,r,src,i,n);
+}
+
+__attribute__((target("sse2")))
+void deinterleave32x2Sse2(uint8_t* l,uint8_t* r,const uint8_t* src,int n){
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m128 x0 = _mm_loadu_ps((const float*)(src + i * 8));
+        __m128 x1 = _mm_loadu_ps((const float*)(src + i * 8 + 16));
+        _mm_storeu_ps((float*)(l + i * 4),_mm_shuffle_ps(x0,x1,_MM_SHUFFLE(2,0,2,0)));
+        _mm_storeu_ps((float*)(r + i * 4),_mm_shuffle_ps(x0,x1,_MM_SHUFFLE(3,1,3,1)));
+    }
+    deinterleaveTail<uint32_t>(l,r,src,i,n);
+}
+
+//多声道按块转置：每轮把第i行与第i+半数行交错，8x8的16位做3轮、4x4的32位做2轮即完成转置
+//交错时行是声道、转置后每行是一个样本的全部声道；解交错反过来，6声道的空位补0
+__attribute__((target("sse2")))
+inline void zip16x8Sse2(__m128i* r){
+    __m128i t0 = _mm_unpacklo_epi16(r[0],r[4]), t1 = _mm_unpackhi_epi16(r[0],r[4]);
+    __m128i t2 = _mm_unpacklo_epi16(r[1],r[5]), t3 = _mm_unpackhi_epi16(r[1],r[5]);
+    __m128i t4 = _mm_unpacklo_epi16(r[2],r[6]), t5 = _mm_unpackhi_epi16(r[2],r[6]);
+    __m128i t6 = _mm_unpacklo_epi16(r[3],r[7]), t7 = _mm_unpackhi_epi16(r[3],r[7]);
+    r[0] = t0; r[1] = t1; r[2] = t2; r[3] = t3; r[4] = t4; r[5] = t5; r[6] = t6; r[7] = t7;
+}
+
+__attribute__((target("sse2")))
+inline void transpose16x8Sse2(__m128i* r){
+    zip16x8Sse2(r);
+    zip16x8Sse2(r);
+    zip16x8Sse2(r);
+}
+
+__attribute__((target("sse2")))
+inline void zip32x4Sse2(__m128i* r){
+    __m128i t0 = _mm_unpacklo_epi32(r[0],r[2]), t1 = _mm_unpackhi_epi32(r[0],r[2]);
+    __m128i t2 = _mm_unpacklo_epi32(r[1],r[3]), t3 = _mm_unpackhi_epi32(r[1],r[3]);
+    r[0] = t0; r[1] = t1; r[2] = t2; r[3] = t3;
+}
+
+__attribute__((target("sse2")))
+inline void transpose32x4Sse2(__m128i* r){
+    zip32x4Sse2(r);
+    zip32x4Sse2(r);
+}
+
+//一个样本的C个16位声道：8声道正好16字节，6声道为8+4字节
+template<int C>
+__attribute__((target("sse2")))
+inline __m128i loadFrame16Sse2(const uint8_t* p){
+    if(C == 8){
+        return _mm_loadu_si128((const __m128i*)p);
+    }
+    int32_t tail;
+    memcpy(&tail,p + 8,4);
+    return _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)p),_mm_cvtsi32_si128(tail));
+}
+
+template<int C>
+__attribute__((target("sse2")))
+inline void storeFrame16Sse2(uint8_t* p,__m128i v){
+    if(C == 8){
+        _mm_storeu_si128((__m128i*)p,v);
+        return;
+    }
+    _mm_storel_epi64((__m128i*)p,v);
+    int32_t tail = _mm_cvtsi128_si32(_mm_srli_si128(v,8));
+    memcpy(p + 8,&tail,4);
+}
+
+template<int C>
+__attribute__((target("sse2")))
+void interleave16xNSse2(uint8_t* dst,const uint8_t* const* src,int n){
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m128i r[8];
+        #pragma GCC unroll 8
+        for(int c = 0; c < 8; c++){
+            r[c] = c < C ? _mm_loadu_si128((const __m128i*)(src[c] + i * 2)) : _mm_setzero_si128();
+        }
+        transpose16x8Sse2(r);
+        #pragma GCC unroll 8
+        for(int k = 0; k < 8; k++){
+            storeFrame16Sse2<C>(dst + (size_t)(i + k) * C * 2,r[k]);
+        }
+    }
+    interleaveTailN<uint16_t,C>(dst,src,i,n);
+}
+
+template<int C>
+__attribute__((target("sse2")))
+void deinterleave16xNSse2(uint8_t* const* dst,const uint8_t* src,int n){
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m128i r[8];
+        #pragma GCC unroll 8
+        for(int k = 0; k < 8; k++){
+            r[k] = loadFrame16Sse2<C>(src + (size_t)(i + k) * C * 2);
+        }
+        transpose16x8Sse2(r);
+        #pragma GCC unroll 8
+        for(int c = 0; c < C; c++){
+            _mm_storeu_si128((__m128i*)(dst[c] + i * 2),r[c]);
+        }
+    }
+    deinterleaveTailN<uint16_t,C>(dst,src,i,n);
+}
+
+//32位分两组4声道转置，6声道的第二组只有2个声道
+template<int C>
+__attribute__((target("sse2")))
+void interleave32xNSse2(uint8_t* dst,const uint8_t* const* src,int n){
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m128i a[4],b[4];
+        #pragma GCC unroll 8
+        for(int c = 0; c < 4; c++){
+            a[c] = _mm_loadu_si128((const __m128i*)(src[c] + i * 4));
+            b[c] = c + 4 < C ? _mm_loadu_si128((const __m128i*)(src[c + 4] + i * 4)) : _mm_setzero_si128();
+        }
+        transpose32x4Sse2(a);
+        transpose32x4Sse2(b);
+        #pragma GCC unroll 8
+        for(int k = 0; k < 4; k++){
+            uint8_t* p = dst + (size_t)(i + k) * C * 4;
+            _mm_storeu_si128((__m128i*)p,a[k]);
+            if(C == 8){
+                _mm_storeu_si128((__m128i*)(p + 16),b[k]);
+            }else{
+                _mm_storel_epi64((__m128i*)(p + 16),b[k]);
+            }
+        }
+    }
+    interleaveTailN<uint32_t,C>(dst,src,i,n);
+}
+
+template<int C>
+__attribute__((target("sse2")))
+void deinterleave32xNSse2(uint8_t* const* dst,const uint8_t* src,int n){
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m128i a[4],b[4];
+        #pragma GCC unroll 8
+        for(int k = 0; k < 4; k++){
+            const uint8_t* p = src + (size_t)(i + k) * C * 4;
+            a[k] = _mm_loadu_si128((const __m128i*)p);
+            b[k] = C == 8 ? _mm_loadu_si128((const __m128i*)(p + 16)) : _mm_loadl_epi64((const __m128i*)(p + 16));
+        }
+        transpose32x4Sse2(a);
+        transpose32x4Sse2(b);
+        #pragma GCC unroll 8
+        for(int c = 0; c < 4; c++){
+            _mm_storeu_si128((__m128i*)(dst[c] + i * 4),a[c]);
+        }
+        #pragma GCC unroll 8
+        for(int c = 4; c < C; c++){
+            _mm_storeu_si128((__m128i*)(dst[c] + i * 4),b[c - 4]);
+        }
+    }
+    deinterleaveTailN<uint32_t,C>(dst,src,i,n);
+}
+
+//AVX2的unpack只在128位半区内进行，需要再跨半区重排
+__attribute__((target("avx2")))
+void interleave16x2Avx2(uint8_t* dst,const uint8_t* l,const uint8_t* r,int n){
+    int i = 0;
+    for(; i + 16 <= n; i += 16){
+        __m256i a = _mm256_loadu_si256((const __m256i*)(l + i * 2));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(r + i * 2));
+        __m256i lo = _mm256_unpacklo_epi16(a,b);
+        __m256i hi = _mm256_unpackhi_epi16(a,b);
+        _mm256_storeu_si256((__m256i*)(dst + i * 4),_mm256_permute2x128_si256(lo,hi,0x20));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4 + 32),_mm256_permute2x128_si256(lo,hi,0x31));
+    }
+    interleaveTail<uint16_t>(dst,l,r,i,n);
+}
+
+__attribute__((target("avx2")))
+void interleave32x2Avx2(uint8_t* dst,const uint8_t* l,const uint8_t* r,int n){
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m256i a = _mm256_loadu_si256((const __m256i*)(l + i * 4));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(r + i * 4));
+        __m256i lo = _mm256_unpacklo_epi32(a,b);
+        __m256i hi = _mm256_unpackhi_epi32(a,b);
+        _mm256_storeu_si256((__m256i*)(dst + i * 8),_mm256_permute2x128_si256(lo,hi,0x20));
+        _mm256_storeu_si256((__m256i*)(dst + i * 8 + 32),_mm256_permute2x128_si256(lo,hi,0x31));
+    }
+    interleaveTail<uint32_t>(dst,l,r,i,n);
+}
+
+__attribute__((target("avx2")))
+void deinterleave16x2Avx2(uint8_t* l,uint8_t* r,const uint8_t* src,int n){
+    int i = 0;
+    for(; i + 16 <= n; i += 16){
+        __m256i x0 = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        __m256i x1 = _mm256_loadu_si256((const __m256i*)(src + i * 4 + 32));
+        __m256i lv = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(x0,16),16),
+                                        _mm256_srai_epi32(_mm256_slli_epi32(x1,16),16));
+        __m256i rv = _mm256_packs_epi32(_mm256_srai_epi32(x0,16),_mm256_srai_epi32(x1,16));
+        _mm256_storeu_si256((__m256i*)(l + i * 2),_mm256_permute4x64_epi64(lv,0xD8));
+        _mm256_storeu_si256((__m256i*)(r + i * 2),_mm256_permute4x64_epi64(rv,0xD8));
+    }
+    deinterleaveTail<uint16_t>(l,r,src,i,n);
+}
+
+__attribute__((target("avx2")))
+void deinterleave32x2Avx2(uint8_t* l,uint8_t* r,const uint8_t* src,int n){
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m256 x0 = _mm256_loadu_ps((const float*)(src + i * 8));
+        __m256 x1 = _mm256_loadu_ps((const float*)(src + i * 8 + 32));
+        __m256i lv = _mm256_castps_si256(_mm256_shuffle_ps(x0,x1,0x88));
+        __m256i rv = _mm256_castps_si256(_mm256_shuffle_ps(x0,x1,0xDD));
+        _mm256_storeu_si256((__m256i*)(l + i * 4),_mm256_permute4x64_epi64(lv,0xD8));
+        _mm256_storeu_si256((__m256i*)(r + i * 4),_mm256_permute4x64_epi64(rv,0xD8));
+    }
+    deinterleaveTail<uint32_t>(l,r,src,i,n);
+}
+#endif
+
+#ifdef SAMPLE_INTERLEAVE_NEON
+void interleave16x2Neon(uint8_t* dst,const uint8_t* l,const uint8_t* r,int n){
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+        uint16x8x2_t v;
+        v.val[0] = vld1q_u16((const uint16_t*)(l + i * 2));
+        v.val[1] = vld1q_u16((const uint16_t*)(r + i * 2));
+        vst2q_u16((uint16_t*)(dst + i * 4),v);
+    }
+    interleaveTail<uint16_t>(dst,l,r,i,n);
+}
+
+void interleave32x2Neon(uint8_t* dst,const uint8_t* l,const uint8_t* r,int n){
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        uint32x4x2_t v;
+        v.val[0] = vld1q_u32((const uint32_t*)(l + i * 4));
+        v.val[1] = vld1q_u32((const uint32_t*)(r + i * 4));
+        vst2q_u32((uint32_t*)(dst + i * 8),v);
+    }
+    interleaveTail<uint32_t>(dst,l,r,i,n);
+}
+
+void deinterleave16x2Neon(uint8_t* l,uint8_t* r,const uint8_t* src,int n){
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+        uint16x8x2_t v = vld2q_u16((const uint16_t*)(src + i * 4));
+        vst1q_u16((uint16_t*)(l + i * 2),v.val[0]);
+        vst1q_u16((uint16_t*)(r + i * 2),v.val[1]);
+    }
+    deinterleaveTail<uint16_t>(l,r,src,i,n);
+}
+
+void deinterleave32x2Neon(uint8_t* l,uint8_t* r,const uint8_t* src,int n){
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        uint32x4x2_t v = vld2q_u32((const uint32_t*)(src + i * 8));
+        vst1q_u32((uint32_t*)(l + i * 4),v.val[0]);
+        vst1q_u32((uint32_t*)(r + i * 4),v.val[1]);
+    }
+    deinterleaveTail<uint32_t>(l,r,src,i,n);
+}
+
+//与SSE2版本相同的转置方式，vzip对应unpacklo/unpackhi
+inline void zip16x8Neon(uint16x8_t* r){
+    uint16x8x2_t z0 = vzipq_u16(r[0],r[4]), z1 = vzipq_u16(r[1],r[5]);
+    uint16x8x2_t z2 = vzipq_u16(r[2],r[6]), z3 = vzipq_u16(r[3],r[7]);
+    r[0] = z0.val[0]; r[1] = z0.val[1]; r[2] = z1.val[0]; r[3] = z1.val[1];
+    r[4] = z2.val[0]; r[5] = z2.val[1]; r[6] = z3.val[0]; r[7] = z3.val[1];
+}
+
+inline void transpose16x8Neon(uint16x8_t* r){
+    zip16x8Neon(r);
+    zip16x8Neon(r);
+    zip16x8Neon(r);
+}
+
+inline void zip32x4Neon(uint32x4_t* r){
+    uint32x4x2_t z0 = vzipq_u32(r[0],r[2]), z1 = vzipq_u32(r[1],r[3]);
+    r[0] = z0.val[0]; r[1] = z0.val[1]; r[2] = z1.val[0]; r[3] = z1.val[1];
+}
+
+inline void transpose32x4Neon(uint32x4_t* r){
+    zip32x4Neon(r);
+    zip32x4Neon(r);
+}
+
+template<int C>
+inline uint16x8_t loadFrame16Neon(const uint8_t* p){
+    const uint16_t* q = (const uint16_t*)p;
+    if(C == 8){
+        return vld1q_u16(q);
+    }
+    uint16x4_t hi = vdup_n_u16(0);
+    hi = vld1_lane_u16(q + 4,hi,0);
+    hi = vld1_lane_u16(q + 5,hi,1);
+    return vcombine_u16(vld1_u16(q),hi);
+}
+
+template<int C>
+inline void storeFrame16Neon(uint8_t* p,uint16x8_t v){
+    uint16_t* q = (uint16_t*)p;
+    if(C == 8){
+        vst1q_u16(q,v);
+        return;
+    }
+    vst1_u16(q,vget_low_u16(v));
+    vst1_lane_u16(q + 4,vget_high_u16(v),0);
+    vst1_lane_u16(q + 5,vget_high_u16(v),1);
+}
+
+template<int C>
+void interleave16xNNeon(uint8_t* dst,const uint8_t* const* src,int n){
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+        uint16x8_t r[8];
+        #pragma GCC unroll 8
+        for(int c = 0; c < 8; c++){
+            r[c] = c < C ? vld1q_u16((const uint16_t*)(src[c] + i * 2)) : vdupq_n_u16(0);
+        }
+        transpose16x8Neon(r);
+        #pragma GCC unroll 8
+        for(int k = 0; k < 8; k++){
+            storeFrame16Neon<C>(dst + (size_t)(i + k) * C * 2,r[k]);
+        }
+    }
+    interleaveTailN<uint16_t,C>(dst,src,i,n);
+}
+
+template<int C>
+void deinterleave16xNNeon(uint8_t* const* dst,const uint8_t* src,int n){
+    int i = 0;
+    for(; i + 8 <= n; i += 8){
+        uint16x8_t r[8];
+        #pragma GCC unroll 8
+        for(int k = 0; k < 8; k++){
+            r[k] = loadFrame16Neon<C>(src + (size_t)(i + k) * C * 2);
+        }
+        transpose16x8Neon(r);
+        #pragma GCC unroll 8
+        for(int c = 0; c < C; c++){
+            vst1q_u16((uint16_t*)(dst[c] + i * 2),r[c]);
+        }
+    }
+    deinterleaveTailN<uint16_t,C>(dst,src,i,n);
+}
+
+template<int C>
+void interleave32xNNeon(uint8_t* dst,const uint8_t* const* src,int n){
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        uint32x4_t a[4],b[4];
+        #pragma GCC unroll 8
+        for(int c = 0; c < 4; c++){
+            a[c] = vld1q_u32((const uint32_t*)(src[c] + i * 4));
+            b[c] = c + 4 < C ? vld1q_u32((const uint32_t*)(src[c + 4] + i * 4)) : vdupq_n_u32(0);
+        }
+        transpose32x4Neon(a);
+        transpose32x4Neon(b);
+        #pragma GCC unroll 8
+        for(int k = 0; k < 4; k++){
+            uint32_t* p = (uint32_t*)(dst + (size_t)(i + k) * C * 4);
+            vst1q_u32(p,a[k]);
+            if(C == 8){
+                vst1q_u32(p + 4,b[k]);
+            }else{
+                vst1_u32(p + 4,vget_low_u32(b[k]));
+            }
+        }
+    }
+    interleaveTailN<uint32_t,C>(dst,src,i,n);
+}
+
+template<int C>
+void deinterleave32xNNeon(uint8_t* const* dst,const uint8_t* src,int n){
+    int i = 0;
+    for(; i + 4 <= n; i += 4){
+        uint32x4_t a[4],b[4];
+        #pragma GCC unroll 8
+        for(int k = 0; k < 4; k++){
+            const uint32_t* p = (const uint32_t*)(src + (size_t)(i + k) * C * 4);
+            a[k] = vld1q_u32(p);
+            b[k] = C == 8 ? vld1q_u32(p + 4) : vcombine_u32(vld1_u32(p + 4),vdup_n_u32(0));
+        }
+        transpose32x4Neon(a);
+        transpose32x4Neon(b);
+        #pragma GCC unroll 8
+        for(int c = 0; c < 4; c++){
+            vst1q_u32((uint32_t*)(dst[c] + i * 4),a[c]);
+        }
+        #pragma GCC unroll 8
+        for(int c = 4; c < C; c++){
+            vst1q_u32((uint32_t*)(dst[c] + i * 4),b[c - 4]);
+        }
+    }
+    deinterleaveTailN<uint32_t,C>(dst,src,i,n);
+}
+#endif
+
+struct Kernels{
+    const char* name;
+    InterleaveStereo interleave16;
+    InterleaveStereo interleave32;
+    DeinterleaveStereo deinterleave16;
+    DeinterleaveStereo deinterleave32;
+    //下标0为6声道，1为8声道
+    InterleaveMulti interleave16xN[2];
+    InterleaveMulti interleave32xN[2];
+    DeinterleaveMulti deinterleave16xN[2];
+    DeinterleaveMulti deinterleave32xN[2];
+};
+
+Kernels selectKernels(){
+#ifdef SAMPLE_INTERLEAVE_X86
+    __builtin_cpu_init();
+    //多声道内核只有SSE2版本，AVX2机器同样使用
+    if(__builtin_cpu_supports("avx2")){
+        return {"avx2",interleave16x2Avx2,interleave32x2Avx2,deinterleave16x2Avx2,deinterleave32x2Avx2,
+                {interleave16xNSse2<6>,interleave16xNSse2<8>},{interleave32xNSse2<6>,interleave32xNSse2<8>},
+                {deinterleave16xNSse2<6>,deinterleave16xNSse2<8>},{deinterleave32xNSse2<6>,deinterleave32xNSse2<8>}};
+    }
+    if(__builtin_cpu_supports("sse2")){
+        return {"sse2",interleave16x2Sse2,interleave32x2Sse2,deinterleave16x2Sse2,deinterleave32x2Sse2,
+                {interleave16xNSse2<6>,interleave16xNSse2<8>},{interleave32xNSse2<6>,interleave32xNSse2<8>},
+                {deinterleave16xNSse2<6>,deinterleave16xNSse2<8>},{deinterleave32xNSse2<6>,deinterleave32xNSse2<8>}};
+    }
+#endif
+#ifdef SAMPLE_INTERLEAVE_NEON
+    return {"neon",interleave16x2Neon,interleave32x2Neon,deinterleave16x2Neon,deinterleave32x2Neon,
+            {interleave16xNNeon<6>,interleave16xNNeon<8>},{interleave32xNNeon<6>,interleave32xNNeon<8>},
+            {deinterleave16xNNeon<6>,deinterleave16xNNeon<8>},{deinterleave32xNNeon<6>,deinterleave32xNNeon<8>}};
+#endif
+    return {"scalar",nullptr,nullptr,nullptr,nullptr,{},{},{},{}};
+}
+
+const Kernels& kernels(){
+    //首次调用时检测一次CPU特性
+    static const Kernels k = selectKernels();
+    return k;
+}
+
+}
+
+const char* SampleInterleave::kernelName(){
+    return kernels().name;
+}
+
+void SampleInterleave::interleaveScalar(uint8_t* dst,const uint8_t* const* src,int channels,int nb_samples,int bytes_per_sample){
+    if(nb_samples <= 0 || channels <= 0){
+        return;
+    }
+    switch(bytes_per_sample){
+        case 1: interleaveT<uint8_t>(dst,src,channels,nb_samples); return;
+        case 2: interleaveT<uint16_t>(dst,src,channels,nb_samples); return;
+        case 4: interleaveT<uint32_t>(dst,src,channels,nb_samples); return;
+        case 8: interleaveT<uint64_t>(dst,src,channels,nb_samples); return;
+    }
+    for(int i = 0; i < nb_samples; i++){
+        for(int c = 0; c < channels; c++){
+            memcpy(dst + ((size_t)i * channels + c) * bytes_per_sample,src[c] + (size_t)i * bytes_per_sample,bytes_per_sample);
+        }
+    }
+}
+
+void SampleInterleave::deinterleaveScalar(uint8_t* const* dst,const uint8_t* src,int channels,int nb_samples,int bytes_per_sample){
+    if(nb_samples <= 0 || channels <= 0){
+        return;
+    }
+    switch(bytes_per_sample){
+        case 1: deinterleaveT<uint8_t>(dst,src,channels,nb_samples); return;
+        case 2: deinterleaveT<uint16_t>(dst,src,channels,nb_samples); return;
+        case 4: deinterleaveT<uint32_t>(dst,src,channels,nb_samples); return;
+        case 8: deinterleaveT<uint64_t>(dst,src,channels,nb_samples); return;
+    }
+    for(int i = 0; i < nb_samples; i++){
+        for(int c = 0; c < channels; c++){
+            memcpy(dst[c] + (size_t)i * bytes_per_sample,src + ((size_t)i * channels + c) * bytes_per_sample,bytes_per_sample);
+        }
+    }
+}
+
+void SampleInterleave::interleave(uint8_t* dst,const uint8_t* const* src,int channels,int nb_samples,int bytes_per_sample){
+    if(nb_samples <= 0 || channels <= 0){
+        return;
+    }
+    if(channels == 1){
+        memcpy(dst,src[0],(size_t)nb_samples * bytes_per_sample);
+        return;
+    }
+    if(channels == 2){
+        const Kernels& k = kernels();
+        if(bytes_per_sample == 2 && k.interleave16){
+            k.interleave16(dst,src[0],src[1],nb_samples);
+            return;
+        }
+        if(bytes_per_sample == 4 && k.interleave32){
+            k.interleave32(dst,src[0],src[1],nb_samples);
+            return;
+        }
+    }
+    if(channels == 6 || channels == 8){
+        const Kernels& k = kernels();
+        InterleaveMulti f = bytes_per_sample == 2 ? k.interleave16xN[channels / 8]
+                          : bytes_per_sample == 4 ? k.interleave32xN[channels / 8] : nullptr;
+        if(f){
+            f(dst,src,nb_samples);
+            return;
+        }
+    }
+    interleaveScalar(dst,src,channels,nb_samples,bytes_per_sample);
+}
+
+void SampleInterleave::deinterleave(uint8_t* const* dst,const uint8_t* src,int channels,int nb_samples,int bytes_per_sample){
+    if(nb_samples <= 0 || channels <= 0){
+        return;
+    }
+    if(channels == 1){
+        memcpy(dst[0],src,(size_t)nb_samples * bytes_per_sample);
+        return;
+    }
+    if(channels == 2){
+        const Kernels& k = kernels();
+        if(bytes_per_sample == 2 && k.deinterleave16){
+            k.deinterleave16(dst[0],dst[1],src,nb_samples);
+            return;
+        }
+        if(bytes_per_sample == 4 && k.deinterleave32){
+            k.deinterleave32(dst[0],dst[1],src,nb_samples);
+            return;
+        }
+    }
+    if(channels == 6 || channels == 8){
+        const Kernels& k = kernels();
+        DeinterleaveMulti f = bytes_per_sample == 2 ? k.deinterleave16xN[channels / 8]
+                            : bytes_per_sample == 4 ? k.deinterleave32xN[channels / 8] : nullptr;
+        if(f){
+            f(dst,src,nb_samples);
+            return;
+        }
+    }
+    deinterleaveScalar(dst,src,channels,nb_samples,bytes_per_sample);
+}
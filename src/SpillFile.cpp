@@ -0,0 +1,92 @@
+#include "SpillFile.hpp"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+SpillFile::~SpillFile(){
+    close();
+}
+
+bool SpillFile::open(const std::string& dir,size_t size){
+    close();
+    if(size == 0){
+        return false;
+    }
+    page_ = (size_t)sysconf(_SC_PAGESIZE);
+    size_ = (size + page_ - 1) / page_ * page_;
+
+    std::string templ = (dir.empty() ? std::string("/tmp") : dir) + "/spill-XXXXXX";
+    std::vector<char> path(templ.begin(),templ.end());
+    path.push_back('\0');
+    fd_ = mkstemp(path.data());
+    if(fd_ < 0){
+        fprintf(stderr,"could not create spill file in %s: %s\n",dir.c_str(),strerror(errno));
+        size_ = 0;
+        return false;
+    }
+    unlink(path.data());
+    if(ftruncate(fd_,(off_t)size_) != 0){
+        fprintf(stderr,"could not size spill file to %zu bytes: %s\n",size_,strerror(errno));
+        close();
+        return false;
+    }
+    void* p = mmap(nullptr,size_,PROT_READ | PROT_WRITE,MAP_SHARED,fd_,0);
+    if(p == MAP_FAILED){
+        fprintf(stderr,"could not map spill file: %s\n",strerror(errno));
+        close();
+        return false;
+    }
+    map_ = (uint8_t*)p;
+    return true;
+}
+
+void SpillFile::close(){
+    if(map_){
+        munmap(map_,size_);
+        map_ = nullptr;
+    }
+    if(fd_ >= 0){
+        ::close(fd_);
+        fd_ = -1;
+    }
+    size_ = 0;
+}
+
+bool SpillFile::pageRange(size_t& offset,size_t& len) const{
+    if(!map_ || offset >= size_){
+        return false;
+    }
+    size_t end = std::min(size_,offset + len);
+    offset = offset / page_ * page_;
+    len = end - offset;
+    return true;
+}
+
+void SpillFile::prefetch(size_t offset,size_t len){
+    if(pageRange(offset,len)){
+        madvise(map_ + offset,len,MADV_WILLNEED);
+    }
+}
+
+void SpillFile::discard(size_t offset,size_t len){
+    //只丢弃完整落在区间内的页，相邻槽位共享的边界页保留
+    if(!map_ || offset >= size_){
+        return;
+    }
+    size_t begin = (offset + page_ - 1) / page_ * page_;
+    size_t end = std::min(size_,offset + len) / page_ * page_;
+    if(end > begin){
+#ifdef MADV_REMOVE
+        //释放文件对应的磁盘块，已消费的数据无需回写
+        if(madvise(map_ + begin,end - begin,MADV_REMOVE) == 0){
+            return;
+        }
+#endif
+        madvise(map_ + begin,end - begin,MADV_DONTNEED);
+    }
+}
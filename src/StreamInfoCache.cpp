@@ -0,0 +1,281 @@
+#include "StreamInfoCache.hpp"
+#include <cstdio>
+#include <cinttypes>
+#include <filesystem>
+
+static const size_t HEAD_HASH_BYTES = 64 * 1024;
+
+std::string StreamInfoCache::Fingerprint::key() const{
+    char buf[64];
+    snprintf(buf,sizeof(buf),"%" PRIx64 "-%" PRIx64 "-%016" PRIx64,
+             (uint64_t)size,(uint64_t)mtime,head_hash);
+    return buf;
+}
+
+StreamInfoCache& StreamInfoCache::shared(){
+    static StreamInfoCache cache;
+    return cache;
+}
+
+bool StreamInfoCache::fingerprint(const std::string& path,Fingerprint& fp){
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fp.size = (int64_t)fs::file_size(path,ec);
+    if(ec) return false;
+    fp.mtime = (int64_t)fs::last_write_time(path,ec).time_since_epoch().count();
+    if(ec) return false;
+
+    FILE* f = fopen(path.c_str(),"rb");
+    if(!f) return false;
+    std::vector<uint8_t> head(HEAD_HASH_BYTES);
+    size_t n = fread(head.data(),1,head.size(),f);
+    fclose(f);
+
+    uint64_t h = 1469598103934665603ULL;
+    for(size_t i = 0; i < n; i++){
+        h ^= head[i];
+        h *= 1099511628211ULL;
+    }
+    fp.head_hash = h;
+    return true;
+}
+
+//FFmpeg 6.1起codecpar带帧率和编码端side data
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(60, 15, 100)
+#define CODECPAR_HAS_FRAMERATE 1
+#endif
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(60, 31, 102)
+#define CODECPAR_HAS_SIDE_DATA 1
+#endif
+
+static std::shared_ptr<AVCodecParameters> makeCodecpar(){
+    AVCodecParameters* par = avcodec_parameters_alloc();
+    if(!par){
+        return nullptr;
+    }
+    return std::shared_ptr<AVCodecParameters>(par,[](AVCodecParameters* p){ avcodec_parameters_free(&p); });
+}
+
+bool StreamInfoCache::capture(const AVFormatContext* fmt_ctx,ProbeInfo& info){
+    info = ProbeInfo();
+    info.start_time = fmt_ctx->start_time;
+    info.duration = fmt_ctx->duration;
+    info.bit_rate = fmt_ctx->bit_rate;
+    for(unsigned int i = 0; i < fmt_ctx->nb_streams; i++){
+        const AVStream* st = fmt_ctx->streams[i];
+        StreamInfo stream;
+        stream.codecpar = makeCodecpar();
+        if(!stream.codecpar || avcodec_parameters_copy(stream.codecpar.get(),st->codecpar) < 0){
+            return false;
+        }
+        stream.time_base = st->time_base;
+        stream.avg_frame_rate = st->avg_frame_rate;
+        stream.r_frame_rate = st->r_frame_rate;
+        stream.sample_aspect_ratio = st->sample_aspect_ratio;
+        stream.start_time = st->start_time;
+        stream.duration = st->duration;
+        stream.nb_frames = st->nb_frames;
+        if(st->codecpar->ch_layout.order == AV_CHANNEL_ORDER_CUSTOM){
+            info.persistable = false;
+        }
+#ifdef CODECPAR_HAS_SIDE_DATA
+        if(st->codecpar->nb_coded_side_data > 0){
+            info.persistable = false;
+        }
+#endif
+        info.streams.push_back(std::move(stream));
+    }
+    return true;
+}
+
+bool StreamInfoCache::apply(AVFormatContext* fmt_ctx,const ProbeInfo& info){
+    if(fmt_ctx->nb_streams != info.streams.size()){
+        return false;
+    }
+    for(unsigned int i = 0; i < fmt_ctx->nb_streams; i++){
+        if(!info.streams[i].codecpar ||
+           fmt_ctx->streams[i]->codecpar->codec_type != info.streams[i].codecpar->codec_type){
+            return false;
+        }
+    }
+
+    for(unsigned int i = 0; i < fmt_ctx->nb_streams; i++){
+        AVStream* st = fmt_ctx->streams[i];
+        const StreamInfo& stream = info.streams[i];
+        if(avcodec_parameters_copy(st->codecpar,stream.codecpar.get()) < 0){
+            return false;
+        }
+        st->time_base = stream.time_base;
+        st->avg_frame_rate = stream.avg_frame_rate;
+        st->r_frame_rate = stream.r_frame_rate;
+        st->sample_aspect_ratio = stream.sample_aspect_ratio;
+        st->start_time = stream.start_time;
+        st->duration = stream.duration;
+        st->nb_frames = stream.nb_frames;
+    }
+    fmt_ctx->start_time = info.start_time;
+    fmt_ctx->duration = info.duration;
+    fmt_ctx->bit_rate = info.bit_rate;
+    return true;
+}
+
+void StreamInfoCache::setCacheDir(const std::string& dir){
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_dir_ = dir;
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir_,ec);
+}
+
+bool StreamInfoCache::lookup(const Fingerprint& fp,ProbeInfo& info){
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string key = fp.key();
+    auto it = entries_.find(key);
+    if(it != entries_.end()){
+        info = it->second;
+        return true;
+    }
+    if(!cache_dir_.empty() && loadFromDisk(key,info)){
+        entries_[key] = info;
+        return true;
+    }
+    return false;
+}
+
+void StreamInfoCache::store(const Fingerprint& fp,const ProbeInfo& info){
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string key = fp.key();
+    entries_[key] = info;
+    if(!cache_dir_.empty() && info.persistable){
+        saveToDisk(key,info);
+    }
+}
+
+//磁盘格式：首行为版本和容器级时长，之后每行一个流；字段增减时改版本号，旧文件读取失败后重新探测
+static const int SINFO_VERSION = 2;
+
+bool StreamInfoCache::loadFromDisk(const std::string& key,ProbeInfo& info){
+    std::string path = cache_dir_ + "/" + key + ".sinfo";
+    FILE* f = fopen(path.c_str(),"r");
+    if(!f){
+        return false;
+    }
+    info = ProbeInfo();
+    int version = 0;
+    unsigned int nb_streams = 0;
+    if(fscanf(f,"v%d %" SCNd64 " %" SCNd64 " %" SCNd64 " %u",
+              &version,&info.start_time,&info.duration,&info.bit_rate,&nb_streams) != 5 ||
+       version != SINFO_VERSION){
+        fclose(f);
+        return false;
+    }
+    for(unsigned int i = 0; i < nb_streams; i++){
+        StreamInfo stream;
+        stream.codecpar = makeCodecpar();
+        AVCodecParameters* par = stream.codecpar.get();
+        if(!par){
+            fclose(f);
+            return false;
+        }
+        int type,codec_id,field_order,color_range,color_primaries,color_trc,color_space,chroma_location;
+        int ch_order,extradata_size;
+        unsigned int codec_tag;
+        uint64_t ch_mask;
+        AVRational framerate;
+        if(fscanf(f,"%d %d %x %d %" SCNd64 " %d %d %d %d %d %d %d/%d %d/%d %d %d %d %d %d %d %d",
+                  &type,&codec_id,&codec_tag,&par->format,&par->bit_rate,
+                  &par->bits_per_coded_sample,&par->bits_per_raw_sample,&par->profile,&par->level,
+                  &par->width,&par->height,&par->sample_aspect_ratio.num,&par->sample_aspect_ratio.den,
+                  &framerate.num,&framerate.den,
+                  &field_order,&color_range,&color_primaries,&color_trc,&color_space,&chroma_location,
+                  &par->video_delay) != 22 ||
+           fscanf(f,"%d %d %" SCNx64 " %d %d %d %d %d %d",
+                  &ch_order,&par->ch_layout.nb_channels,&ch_mask,&par->sample_rate,&par->block_align,
+                  &par->frame_size,&par->initial_padding,&par->trailing_padding,&par->seek_preroll) != 9 ||
+           fscanf(f,"%d/%d %d/%d %d/%d %d/%d %" SCNd64 " %" SCNd64 " %" SCNd64 " %d",
+                  &stream.time_base.num,&stream.time_base.den,
+                  &stream.avg_frame_rate.num,&stream.avg_frame_rate.den,
+                  &stream.r_frame_rate.num,&stream.r_frame_rate.den,
+                  &stream.sample_aspect_ratio.num,&stream.sample_aspect_ratio.den,
+                  &stream.start_time,&stream.duration,&stream.nb_frames,&extradata_size) != 12 ||
+           extradata_size < 0){
+            fclose(f);
+            return false;
+        }
+        par->codec_type = (AVMediaType)type;
+        par->codec_id = (AVCodecID)codec_id;
+        par->codec_tag = codec_tag;
+        par->field_order = (AVFieldOrder)field_order;
+        par->color_range = (AVColorRange)color_range;
+        par->color_primaries = (AVColorPrimaries)color_primaries;
+        par->color_trc = (AVColorTransferCharacteristic)color_trc;
+        par->color_space = (AVColorSpace)color_space;
+        par->chroma_location = (AVChromaLocation)chroma_location;
+        par->ch_layout.order = (AVChannelOrder)ch_order;
+        if(ch_order == AV_CHANNEL_ORDER_NATIVE){
+            par->ch_layout.u.mask = ch_mask;
+        }
+#ifdef CODECPAR_HAS_FRAMERATE
+        par->framerate = framerate;
+#endif
+        if(extradata_size > 0){
+            par->extradata = (uint8_t*)av_mallocz(extradata_size + AV_INPUT_BUFFER_PADDING_SIZE);
+            if(!par->extradata){
+                fclose(f);
+                return false;
+            }
+            par->extradata_size = extradata_size;
+            for(int j = 0; j < extradata_size; j++){
+                unsigned int v;
+                if(fscanf(f,"%2x",&v) != 1){
+                    fclose(f);
+                    return false;
+                }
+                par->extradata[j] = (uint8_t)v;
+            }
+        }
+        info.streams.push_back(std::move(stream));
+    }
+    fclose(f);
+    return !info.streams.empty();
+}
+
+void StreamInfoCache::saveToDisk(const std::string& key,const ProbeInfo& info){
+    std::string path = cache_dir_ + "/" + key + ".sinfo";
+    FILE* f = fopen(path.c_str(),"w");
+    if(!f){
+        fprintf(stderr,"Could not write stream info cache %s\n",path.c_str());
+        return;
+    }
+    fprintf(f,"v%d %" PRId64 " %" PRId64 " %" PRId64 " %u\n",
+            SINFO_VERSION,info.start_time,info.duration,info.bit_rate,(unsigned int)info.streams.size());
+    for(const StreamInfo& stream : info.streams){
+        const AVCodecParameters* par = stream.codecpar.get();
+        AVRational framerate = {0,1};
+#ifdef CODECPAR_HAS_FRAMERATE
+        framerate = par->framerate;
+#endif
+        fprintf(f,"%d %d %x %d %" PRId64 " %d %d %d %d %d %d %d/%d %d/%d %d %d %d %d %d %d %d ",
+                (int)par->codec_type,(int)par->codec_id,par->codec_tag,par->format,par->bit_rate,
+                par->bits_per_coded_sample,par->bits_per_raw_sample,par->profile,par->level,
+                par->width,par->height,par->sample_aspect_ratio.num,par->sample_aspect_ratio.den,
+                framerate.num,framerate.den,
+                (int)par->field_order,(int)par->color_range,(int)par->color_primaries,(int)par->color_trc,
+                (int)par->color_space,(int)par->chroma_location,par->video_delay);
+        fprintf(f,"%d %d %" PRIx64 " %d %d %d %d %d %d ",
+                (int)par->ch_layout.order,par->ch_layout.nb_channels,
+                par->ch_layout.order == AV_CHANNEL_ORDER_NATIVE ? (uint64_t)par->ch_layout.u.mask : (uint64_t)0,
+                par->sample_rate,par->block_align,par->frame_size,
+                par->initial_padding,par->trailing_padding,par->seek_preroll);
+        fprintf(f,"%d/%d %d/%d %d/%d %d/%d %" PRId64 " %" PRId64 " %" PRId64 " %d ",
+                stream.time_base.num,stream.time_base.den,
+                stream.avg_frame_rate.num,stream.avg_frame_rate.den,
+                stream.r_frame_rate.num,stream.r_frame_rate.den,
+                stream.sample_aspect_ratio.num,stream.sample_aspect_ratio.den,
+                stream.start_time,stream.duration,stream.nb_frames,par->extradata_size);
+        for(int i = 0; i < par->extradata_size; i++){
+            fprintf(f,"%02x",par->extradata[i]);
+        }
+        fprintf(f,"\n");
+    }
+    fclose(f);
+}
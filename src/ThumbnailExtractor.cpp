@@ -0,0 +1,311 @@
+#include "ThumbnailExtractor.hpp"
+#include "demuxer.hpp"
+#include "videoDecoder.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+#include <algorithm>
+extern "C"{
+    #include <libavutil/imgutils.h>
+    #include <libavutil/pixdesc.h>
+}
+
+ThumbnailExtractor::ThumbnailExtractor(const ThumbnailOptions& options):options_(options){
+    options_.count = std::max(1,options_.count);
+    options_.jpeg_quality = std::min(31,std::max(2,options_.jpeg_quality));
+    options_.sprite_columns = std::max(1,options_.sprite_columns);
+}
+
+AVPixelFormat ThumbnailExtractor::outputPixFmt() const{
+    return options_.format == ThumbnailFormat::JPEG ? AV_PIX_FMT_YUVJ420P : AV_PIX_FMT_RGB24;
+}
+
+const char* ThumbnailExtractor::extension() const{
+    return options_.format == ThumbnailFormat::JPEG ? ".jpg" : ".png";
+}
+
+int ThumbnailExtractor::extract(const std::string& inputPath,const std::string& outputDir){
+    namespace fs = std::filesystem;
+    Demuxer probe;
+    if(!probe.loadfile(inputPath.c_str()) || !probe.open_video_format()){
+        fprintf(stderr,"No video stream in %s\n",inputPath.c_str());
+        return 0;
+    }
+    AVFormatContext* fmt = probe.get_fmx();
+    int64_t start = fmt->start_time != AV_NOPTS_VALUE ? fmt->start_time : 0;
+    int64_t duration = fmt->duration != AV_NOPTS_VALUE ? fmt->duration : 0;
+
+    //取点：按间隔或均匀分布，时长未知时只取开头
+    std::vector<Sample> samples;
+    if(duration <= 0){
+        samples.resize(1);
+        samples[0].target = start;
+    }else if(options_.interval > 0){
+        int64_t step = (int64_t)(options_.interval * AV_TIME_BASE);
+        for(int64_t t = 0; t < duration && (int)samples.size() < options_.count; t += step){
+            Sample s;
+            s.target = start + t;
+            samples.push_back(s);
+        }
+    }else{
+        samples.resize(options_.count);
+        for(int i = 0; i < options_.count; i++){
+            samples[i].target = start + av_rescale(duration,2 * i + 1,2 * options_.count);
+        }
+    }
+
+    std::error_code ec;
+    fs::create_directories(outputDir,ec);
+    std::string prefix = (fs::path(outputDir) / fs::path(inputPath).stem()).string();
+
+    int cores = (int)std::max(1u,std::thread::hardware_concurrency());
+    int workers = options_.workers > 0 ? options_.workers : cores;
+    workers = std::max(1,std::min<int>(workers,(int)samples.size()));
+    int decoder_threads = std::max(1,cores / workers);
+
+    //每个worker负责一段连续的取点，定位基本是单向前进
+    std::vector<std::thread> threads;
+    size_t per = (samples.size() + workers - 1) / workers;
+    for(size_t begin = 0; begin < samples.size(); begin += per){
+        size_t end = std::min(samples.size(),begin + per);
+        threads.emplace_back(&ThumbnailExtractor::extractRange,this,std::cref(inputPath),std::cref(prefix),
+                             std::ref(samples),begin,end,decoder_threads);
+    }
+    for(auto& t : threads){
+        t.join();
+    }
+
+    int written = 0;
+    if(options_.sprite){
+        AVFrame* sheet = buildSprite(samples);
+        if(sheet && writeImage(sheet,prefix + "_sprite" + extension())){
+            written = 1;
+            //雪碧图索引：格子序号与对应时间（秒），只列出实际拼进去的取点
+            FILE* f = fopen((prefix + "_sprite.txt").c_str(),"w");
+            if(f){
+                for(const Sample& s : samples){
+                    if(s.tile < 0) continue;
+                    int64_t ts = s.pts != AV_NOPTS_VALUE ? s.pts : s.target;
+                    fprintf(f,"%d %.3f\n",s.tile,(ts - start) / (double)AV_TIME_BASE);
+                }
+                fclose(f);
+            }
+        }
+        av_frame_free(&sheet);
+    }else{
+        for(const Sample& s : samples){
+            written += s.written ? 1 : 0;
+        }
+    }
+    for(Sample& s : samples){
+        av_frame_free(&s.image);
+    }
+    printf("thumbnails: %d of %zu written for %s\n",written,options_.sprite ? (size_t)1 : samples.size(),inputPath.c_str());
+    return written;
+}
+
+void ThumbnailExtractor::extractRange(const std::string& inputPath,const std::string& prefix,
+                                      std::vector<Sample>& samples,size_t begin,size_t end,int decoder_threads){
+    Demuxer demuxer;
+    if(!demuxer.loadfile(inputPath.c_str()) || !demuxer.open_video_format()){
+        return;
+    }
+    demuxer.applyStreamDiscard();
+
+    videoDecoder decoder;
+    DecoderThreadConfig thread_config;
+    thread_config.max_threads = decoder_threads;
+    thread_config.low_delay = true;     // 帧线程会让每个取点多读若干关键帧
+    decoder.setThreadConfig(thread_config);
+    decoder.setSkipFrame(AVDISCARD_NONKEY);
+    if(!decoder.initialize_fromstream(demuxer.get_videostream()->codecpar)){
+        return;
+    }
+
+    SwsContext* sws = nullptr;
+    char path[1024];
+    for(size_t i = begin; i < end; i++){
+        Sample& sample = samples[i];
+        if(!grab(demuxer,decoder,sws,sample) || options_.sprite){
+            continue;
+        }
+        snprintf(path,sizeof(path),"%s_%04zu%s",prefix.c_str(),i + 1,extension());
+        sample.written = writeImage(sample.image,path);
+    }
+    sws_freeContext(sws);
+}
+
+bool ThumbnailExtractor::grab(Demuxer& demuxer,videoDecoder& decoder,SwsContext*& sws,Sample& sample){
+    if(!demuxer.seekTo(sample.target)){
+        return false;
+    }
+    int idx = demuxer.getVideoStreamIndex();
+    AVRational tb = demuxer.get_videostream()->time_base;
+
+    bool got = false;
+    auto on_frame = [&](AVFrame* frame){
+        if(got){
+            return false;
+        }
+        sample.image = scale(sws,frame);
+        if(frame->best_effort_timestamp != AV_NOPTS_VALUE){
+            sample.pts = av_rescale_q(frame->best_effort_timestamp,tb,AV_TIME_BASE_Q);
+        }
+        got = sample.image != nullptr;
+        return !got;
+    };
+
+    AVPacket* pkt = PacketPool::instance().acquire();
+    while(!got && demuxer.readPacket(pkt) >= 0){
+        //非关键帧包直接丢掉，连解析都省掉
+        if(pkt->stream_index == idx && (pkt->flags & AV_PKT_FLAG_KEY)){
+            decoder.decode(pkt,on_frame);
+        }
+        av_packet_unref(pkt);
+    }
+    PacketPool::instance().release(pkt);
+    //定位后必须清空解码器；还没拿到帧时顺便取出延迟输出的那一帧
+    decoder.drain(on_frame);
+    return got;
+}
+
+AVFrame* ThumbnailExtractor::scale(SwsContext*& sws,const AVFrame* frame){
+    int dst_w = frame->width;
+    int dst_h = frame->height;
+    if(options_.width > 0 && options_.width < frame->width){
+        //按显示宽高比缩放
+        AVRational sar = frame->sample_aspect_ratio;
+        int64_t display_w = sar.num > 0 && sar.den > 0 ? av_rescale(frame->width,sar.num,sar.den) : frame->width;
+        dst_w = options_.width;
+        dst_h = (int)av_rescale(frame->height,dst_w,display_w);
+    }
+    dst_w = std::max(2,dst_w & ~1);
+    dst_h = std::max(2,dst_h & ~1);
+
+    sws = sws_getCachedContext(sws,frame->width,frame->height,(AVPixelFormat)frame->format,
+                               dst_w,dst_h,outputPixFmt(),SWS_FAST_BILINEAR,nullptr,nullptr,nullptr);
+    if(!sws){
+        fprintf(stderr,"can not create thumbnail scaler\n");
+        return nullptr;
+    }
+    AVFrame* out = av_frame_alloc();
+    if(!out){
+        return nullptr;
+    }
+    out->width = dst_w;
+    out->height = dst_h;
+    out->format = outputPixFmt();
+    if(av_frame_get_buffer(out,0) < 0){
+        av_frame_free(&out);
+        return nullptr;
+    }
+    sws_scale(sws,frame->data,frame->linesize,0,frame->height,out->data,out->linesize);
+    return out;
+}
+
+AVFrame* ThumbnailExtractor::buildSprite(std::vector<Sample>& samples){
+    const AVFrame* first = nullptr;
+    for(Sample& s : samples){
+        s.tile = -1;
+        first = first ? first : s.image;
+    }
+    if(!first){
+        return nullptr;
+    }
+    int w = first->width;
+    int h = first->height;
+    //中途分辨率变化的帧尺寸不同，不放进雪碧图；索引按这里的编号写出
+    int n = 0;
+    for(Sample& s : samples){
+        if(s.image && s.image->width == w && s.image->height == h){
+            s.tile = n++;
+        }
+    }
+    int cols = std::min(options_.sprite_columns,n);
+    int rows = (n + cols - 1) / cols;
+    AVPixelFormat fmt = outputPixFmt();
+
+    AVFrame* sheet = av_frame_alloc();
+    if(!sheet){
+        return nullptr;
+    }
+    sheet->width = w * cols;
+    sheet->height = h * rows;
+    sheet->format = fmt;
+    if(av_frame_get_buffer(sheet,0) < 0){
+        av_frame_free(&sheet);
+        return nullptr;
+    }
+    ptrdiff_t linesizes[4];
+    for(int i = 0; i < 4; i++){
+        linesizes[i] = sheet->linesize[i];
+    }
+    av_image_fill_black(sheet->data,linesizes,fmt,AVCOL_RANGE_JPEG,sheet->width,sheet->height);
+
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(fmt);
+    for(const Sample& s : samples){
+        if(s.tile < 0){
+            continue;
+        }
+        int col = s.tile % cols;
+        int row = s.tile / cols;
+        //用col*w宽度算出的行宽正好是各平面内的横向字节偏移
+        int x_offset[4] = {0};
+        if(col > 0){
+            av_image_fill_linesizes(x_offset,fmt,col * w);
+        }
+        uint8_t* dst[4] = {nullptr};
+        for(int p = 0; p < 4 && sheet->data[p]; p++){
+            int shift = (p == 1 || p == 2) ? desc->log2_chroma_h : 0;
+            dst[p] = sheet->data[p] + (ptrdiff_t)((row * h) >> shift) * sheet->linesize[p] + x_offset[p];
+        }
+        av_image_copy(dst,sheet->linesize,(const uint8_t**)s.image->data,s.image->linesize,fmt,w,h);
+    }
+    return sheet;
+}
+
+bool ThumbnailExtractor::writeImage(AVFrame* image,const std::string& path){
+    bool jpeg = options_.format == ThumbnailFormat::JPEG;
+    const AVCodec* codec = avcodec_find_encoder(jpeg ? AV_CODEC_ID_MJPEG : AV_CODEC_ID_PNG);
+    if(!codec){
+        fprintf(stderr,"Image encoder not found\n");
+        return false;
+    }
+    AVCodecContext* ctx = avcodec_alloc_context3(codec);
+    if(!ctx){
+        return false;
+    }
+    ctx->width = image->width;
+    ctx->height = image->height;
+    ctx->pix_fmt = (AVPixelFormat)image->format;
+    ctx->time_base = {1,25};
+    if(jpeg){
+        ctx->flags |= AV_CODEC_FLAG_QSCALE;
+        ctx->global_quality = FF_QP2LAMBDA * options_.jpeg_quality;
+        ctx->color_range = AVCOL_RANGE_JPEG;
+        image->quality = ctx->global_quality;
+    }
+    image->pts = 0;
+
+    bool ok = false;
+    FILE* f = nullptr;
+    AVPacket* pkt = PacketPool::instance().acquire();
+    if(avcodec_open2(ctx,codec,nullptr) < 0){
+        fprintf(stderr,"Could not open image encoder\n");
+    }else if(avcodec_send_frame(ctx,image) >= 0 && avcodec_send_frame(ctx,nullptr) >= 0){
+        f = fopen(path.c_str(),"wb");
+        if(!f){
+            fprintf(stderr,"Could not open %s\n",path.c_str());
+        }
+        while(f && avcodec_receive_packet(ctx,pkt) >= 0){
+            ok = fwrite(pkt->data,1,pkt->size,f) == (size_t)pkt->size;
+            av_packet_unref(pkt);
+        }
+    }
+    if(f){
+        fclose(f);
+    }
+    PacketPool::instance().release(pkt);
+    avcodec_free_context(&ctx);
+    return ok;
+}
@@ -35,8 +35,8 @@ bool VideoEncoder::init(const char* name, AVCodecID id,AVDictionary* opt_arg){
     c->width = width_;
     c->height = height_;
 
-    c->time_base = (AVRational){1,fps_};
-    c->framerate = (AVRational){fps_,1};
+    c->time_base = time_base_.num > 0 ? time_base_ : (AVRational){1,fps_};
+    c->framerate = framerate_.num > 0 ? framerate_ : (AVRational){fps_,1};
 
     c->pix_fmt = target_pix_fmt_;
     c->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
@@ -94,20 +94,20 @@ bool VideoEncoder::init(const char* name, AVCodecID id,AVDictionary* opt_arg){
 
     while (ret >= 0)
     {
-        AVPacket* pkt = av_packet_alloc();
+        AVPacket* pkt = PacketPool::instance().acquire();
         if(!pkt){
             fprintf(stderr,"Could not allocate packet\n");
             return AVERROR(ENOMEM);
         }
         ret = avcodec_receive_packet(c, pkt);
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            av_packet_free(&pkt);
+            PacketPool::instance().release(pkt);
             break;  
         } else if (ret < 0) {
             char errbuf[AV_ERROR_MAX_STRING_SIZE];
             av_strerror(ret, errbuf, sizeof(errbuf));
             fprintf(stderr, "Error receiving packet from video encoder: %s\n", errbuf);
-            av_packet_free(&pkt);
+            PacketPool::instance().release(pkt);
             return ret;
         }
 
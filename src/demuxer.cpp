@@ -1,26 +1,144 @@
 #include "demuxer.hpp"
 #include <iostream>
+#include <filesystem>
+#include <cinttypes>
 
-Demuxer::Demuxer() {
+Demuxer::Demuxer()
+    : video_stream(nullptr), audio_stream(nullptr)
+    , video_stream_idx(-1), audio_stream_idx(-1)
+    , prefetch_stop_(false) {
 }
 
 Demuxer::~Demuxer() {
+    closeInput();
+}
+
+void Demuxer::closeInput(){
+    stopPrefetch();
     if (fmt_ctx) {
         avformat_close_input(&fmt_ctx);
         fmt_ctx = nullptr;
     }
+    //自定义IO的AVIOContext不由avformat_close_input释放
+    io_reader_.reset();
+    video_stream = nullptr;
+    audio_stream = nullptr;
+    video_stream_idx = -1;
+    audio_stream_idx = -1;
 }
 
-bool Demuxer::loadfile(const char* src_filename){
-    if(avformat_open_input(&fmt_ctx,src_filename,NULL,NULL) < 0){
-        fprintf(stderr,"could not open source file %s\n",src_filename);
-        exit(1);
+void Demuxer::setIOBackend(IOBackend backend,size_t buffer_size){
+    io_backend_ = backend;
+    io_buffer_size_ = buffer_size;
+}
+
+bool Demuxer::openInput(const char* url){
+    if(io_reader_){
+        fmt_ctx = avformat_alloc_context();
+        if(!fmt_ctx){
+            fprintf(stderr,"Could not allocate format context\n");
+            return false;
+        }
+        fmt_ctx->pb = io_reader_->getContext();
+        if(!fmt_ctx->pb){
+            avformat_free_context(fmt_ctx);
+            fmt_ctx = nullptr;
+            return false;
+        }
+        fmt_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
     }
 
+    AVDictionary* opts = nullptr;
+    if(probe_options_.fast){
+        av_dict_set_int(&opts,"probesize",probe_options_.probesize,0);
+        av_dict_set_int(&opts,"analyzeduration",probe_options_.analyzeduration,0);
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    int ret = avformat_open_input(&fmt_ctx,url,NULL,&opts);
+    av_dict_free(&opts);
+    if(ret < 0){
+        //失败时avformat_open_input已释放fmt_ctx(含自定义IO时分配的)，只需清理IO读取器
+        fprintf(stderr,"could not open source file %s\n",url);
+        fmt_ctx = nullptr;
+        io_reader_.reset();
+        return false;
+    }
+    open_stats_.open_ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return probeStreams();
+}
+
+bool Demuxer::probeStreams(){
+    StreamInfoCache::Fingerprint fp;
+    bool cacheable = probe_options_.use_cache &&
+                     StreamInfoCache::fingerprint(src_filename_,fp);
+    if(cacheable){
+        StreamInfoCache::ProbeInfo info;
+        if(StreamInfoCache::shared().lookup(fp,info) && StreamInfoCache::apply(fmt_ctx,info)){
+            open_stats_.cache_hit = true;
+            return true;
+        }
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
     if(avformat_find_stream_info(fmt_ctx,NULL) < 0){
         fprintf(stderr,"Could not find stream information\n");
         return false;
     }
+    open_stats_.probe_ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - t0).count();
+    if(cacheable){
+        StreamInfoCache::ProbeInfo info;
+        if(StreamInfoCache::capture(fmt_ctx,info)){
+            StreamInfoCache::shared().store(fp,info);
+        }
+    }
+    return true;
+}
+
+bool Demuxer::loadmemory(const uint8_t* data,size_t size,size_t buffer_size){
+    closeInput();
+    io_reader_ = buffer_size ? std::make_unique<MemoryReader>(data,size,buffer_size)
+                             : std::make_unique<MemoryReader>(data,size);
+    if(!io_reader_->open()){
+        io_reader_.reset();
+        return false;
+    }
+    src_filename_.clear();
+    keyframe_index_.clear();
+    open_stats_ = OpenStats();
+    open_start_ = std::chrono::steady_clock::now();
+    first_packet_seen_ = false;
+    selected_streams_.clear();
+    return openInput("memory:");
+}
+
+bool Demuxer::loadfile(const char* src_filename){
+    std::string path(src_filename);
+    open_stats_ = OpenStats();
+    open_start_ = std::chrono::steady_clock::now();
+    first_packet_seen_ = false;
+    selected_streams_.clear();
+    src_filename_ = path;
+    //DEFAULT后端由avformat自己打开文件，不能沿用上一次loadmemory等留下的读取器
+    closeInput();
+    if(io_backend_ != IOBackend::DEFAULT || path == "-"){
+        io_reader_ = AVIOReaderFactory::createReader(path,io_backend_,io_buffer_size_);
+        if(!io_reader_ || !io_reader_->open()){
+            fprintf(stderr,"could not open source file %s\n",src_filename);
+            io_reader_.reset();
+            return false;
+        }
+    }
+    if(!openInput(src_filename)){
+        return false;
+    }
+    keyframe_index_.clear();
+    rewind_failed_ = false;
+    //没有索引时seek退化为容器自身的查找；但扫描后回绕失败时fmt_ctx停在文件尾，只能按加载失败处理
+    if(index_enabled_ && !loadOrBuildIndex() && rewind_failed_){
+        fprintf(stderr,"could not rewind %s after building keyframe index\n",src_filename);
+        closeInput();
+        return false;
+    }
     return true;
 }
 
@@ -32,6 +150,7 @@ bool Demuxer::open_video_format(){
     {
         video_stream_idx = ret;
         video_stream = fmt_ctx->streams[video_stream_idx];
+        selectStream(video_stream_idx);
         return true;
     }
     return false;
@@ -45,6 +164,7 @@ bool Demuxer::open_audio_format(){
     {
         audio_stream_idx = ret;
         audio_stream = fmt_ctx->streams[audio_stream_idx];
+        selectStream(audio_stream_idx);
         return true;
     }
     return false;
@@ -56,11 +176,50 @@ int Demuxer::stream_init(enum AVMediaType type)
     if (ret < 0) {
         fprintf(stderr, "Could not find %s stream in input file\n",
                 av_get_media_type_string(type));
-        exit(1);
     }
     return ret;
 }
 
+int Demuxer::getStreamCount() const{
+    return fmt_ctx ? (int)fmt_ctx->nb_streams : 0;
+}
+
+AVStream* Demuxer::getStream(int index) const{
+    if(!fmt_ctx || index < 0 || index >= (int)fmt_ctx->nb_streams){
+        return nullptr;
+    }
+    return fmt_ctx->streams[index];
+}
+
+std::vector<int> Demuxer::getStreamIndices(AVMediaType type) const{
+    std::vector<int> indices;
+    for(int i = 0; i < getStreamCount(); i++){
+        if(fmt_ctx->streams[i]->codecpar->codec_type == type){
+            indices.push_back(i);
+        }
+    }
+    return indices;
+}
+
+bool Demuxer::selectStream(int index){
+    if(!getStream(index)){
+        return false;
+    }
+    selected_streams_.insert(index);
+    return true;
+}
+
+void Demuxer::unselectStream(int index){
+    selected_streams_.erase(index);
+}
+
+void Demuxer::applyStreamDiscard(){
+    //没有消费者的流不再解析和拷贝
+    for(int i = 0; i < getStreamCount(); i++){
+        fmt_ctx->streams[i]->discard = isStreamSelected(i) ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+}
+
 
 AVStream* Demuxer::get_audiostream() const {
     if (!audio_stream) {
@@ -94,4 +253,283 @@ int Demuxer::getAudioStreamIndex() const{
         fprintf(stderr,"Warning: no videostream_dix");
     }
     return audio_stream_idx;
-}
\ No newline at end of file
+}
+
+bool Demuxer::startPrefetch(){
+    if(!prefetch_config_.enabled || !fmt_ctx){
+        return false;
+    }
+    if(prefetch_thread_){
+        return true;
+    }
+
+    queues_.clear();
+    for(int index : selected_streams_){
+        queues_[index];
+    }
+    if(queues_.empty()){
+        fprintf(stderr,"Prefetch needs at least one selected stream\n");
+        return false;
+    }
+
+    packet_seq_ = 0;
+    reader_eof_ = false;
+    reader_error_ = 0;
+    prefetch_stop_ = false;
+    try{
+        prefetch_thread_ = std::make_unique<std::thread>(&Demuxer::prefetchLoop,this);
+    }catch(const std::exception& e){
+        fprintf(stderr,"Failed to start prefetch thread: %s\n",e.what());
+        return false;
+    }
+    return true;
+}
+
+void Demuxer::stopPrefetch(){
+    if(!prefetch_thread_){
+        return;
+    }
+    prefetch_stop_ = true;
+    space_cv_.notify_all();
+    data_cv_.notify_all();
+    if(prefetch_thread_->joinable()){
+        prefetch_thread_->join();
+    }
+    prefetch_thread_.reset();
+    clearQueues();
+}
+
+void Demuxer::clearQueues(){
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    for(auto& kv : queues_){
+        for(auto& item : kv.second.packets){
+            PacketPool::instance().release(item.second);
+        }
+        kv.second.packets.clear();
+        kv.second.bytes = 0;
+    }
+}
+
+bool Demuxer::queueAboveHigh(const StreamQueue& q) const{
+    return q.packets.size() >= prefetch_config_.high_packets ||
+           q.bytes >= prefetch_config_.high_bytes;
+}
+
+bool Demuxer::queueBelowLow(const StreamQueue& q) const{
+    return q.packets.size() <= prefetch_config_.low_packets &&
+           q.bytes <= prefetch_config_.low_bytes;
+}
+
+void Demuxer::prefetchLoop(){
+    while(!prefetch_stop_){
+        AVPacket* pkt = PacketPool::instance().acquire();
+        if(!pkt){
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            reader_eof_ = true;
+            reader_error_ = AVERROR(ENOMEM);
+            data_cv_.notify_all();
+            return;
+        }
+
+        int ret = av_read_frame(fmt_ctx,pkt);
+        if(ret < 0){
+            PacketPool::instance().release(pkt);
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            reader_eof_ = true;
+            reader_error_ = ret;
+            data_cv_.notify_all();
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        auto it = queues_.find(pkt->stream_index);
+        if(it == queues_.end()){
+            lock.unlock();
+            PacketPool::instance().release(pkt);
+            continue;
+        }
+
+        StreamQueue& q = it->second;
+        if(queueAboveHigh(q)){
+            space_cv_.wait(lock,[this,&q]{
+                return prefetch_stop_ || queueBelowLow(q);
+            });
+        }
+        if(prefetch_stop_){
+            lock.unlock();
+            PacketPool::instance().release(pkt);
+            break;
+        }
+        q.bytes += pkt->size;
+        q.packets.emplace_back(packet_seq_++,pkt);
+        data_cv_.notify_one();
+    }
+}
+
+void Demuxer::markFirstPacket(){
+    first_packet_seen_ = true;
+    open_stats_.time_to_first_packet_ms =
+        std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - open_start_).count();
+    if(probe_options_.log_stats){
+        printf("Demuxer open stats: open=%.2f ms probe=%.2f ms cache_hit=%s time_to_first_packet=%.2f ms\n",
+               open_stats_.open_ms,open_stats_.probe_ms,open_stats_.cache_hit ? "yes" : "no",
+               open_stats_.time_to_first_packet_ms);
+    }
+}
+
+int Demuxer::readPacket(AVPacket* pkt){
+    int ret = readPacketInternal(pkt);
+    if(ret >= 0 && !first_packet_seen_){
+        markFirstPacket();
+    }
+    return ret;
+}
+
+int Demuxer::readPacketInternal(AVPacket* pkt){
+    if(!prefetch_thread_){
+        return av_read_frame(fmt_ctx,pkt);
+    }
+
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    StreamQueue* next = nullptr;
+    data_cv_.wait(lock,[this,&next]{
+        next = nullptr;
+        for(auto& kv : queues_){
+            StreamQueue& q = kv.second;
+            if(!q.packets.empty() &&
+               (!next || q.packets.front().first < next->packets.front().first)){
+                next = &q;
+            }
+        }
+        return next || reader_eof_ || prefetch_stop_;
+    });
+
+    if(!next){
+        return reader_error_ ? reader_error_ : AVERROR_EOF;
+    }
+
+    //按读取顺序交付，保持与av_read_frame相同的交织顺序
+    AVPacket* queued = next->packets.front().second;
+    next->packets.pop_front();
+    next->bytes -= queued->size;
+    if(queueBelowLow(*next)){
+        space_cv_.notify_one();
+    }
+    lock.unlock();
+
+    av_packet_move_ref(pkt,queued);
+    PacketPool::instance().release(queued);
+    return 0;
+}
+
+bool Demuxer::loadOrBuildIndex(){
+    namespace fs = std::filesystem;
+    //管道等不可seek的输入无法扫描后回绕，也没有可复用的sidecar
+    if(!fmt_ctx->pb || !(fmt_ctx->pb->seekable & AVIO_SEEKABLE_NORMAL)){
+        return false;
+    }
+    std::error_code ec;
+    int64_t file_size = (int64_t)fs::file_size(src_filename_,ec);
+    if(ec){
+        return false;
+    }
+    int64_t mtime = (int64_t)fs::last_write_time(src_filename_,ec).time_since_epoch().count();
+    std::string sidecar = KeyframeIndex::sidecarPath(src_filename_);
+    if(keyframe_index_.load(sidecar,file_size,mtime)){
+        return true;
+    }
+    if(!buildKeyframeIndex()){
+        return false;
+    }
+    keyframe_index_.save(sidecar,file_size,mtime);
+    return true;
+}
+
+bool Demuxer::buildKeyframeIndex(){
+    if(!fmt_ctx){
+        return false;
+    }
+    bool was_prefetching = isPrefetching();
+    stopPrefetch();
+    rewind_failed_ = false;
+    bool ok = keyframe_index_.build(fmt_ctx);
+    int64_t start = fmt_ctx->start_time != AV_NOPTS_VALUE ? fmt_ctx->start_time : 0;
+    if(avformat_seek_file(fmt_ctx,-1,INT64_MIN,start,INT64_MAX,0) < 0){
+        fprintf(stderr,"Could not rewind after building keyframe index\n");
+        rewind_failed_ = true;
+        ok = false;
+    }
+    if(was_prefetching){
+        startPrefetch();
+    }
+    return ok;
+}
+
+int Demuxer::referenceStreamIndex() const{
+    if(video_stream_idx >= 0) return video_stream_idx;
+    if(audio_stream_idx >= 0) return audio_stream_idx;
+    return -1;
+}
+
+bool Demuxer::seekTo(int64_t timestamp){
+    if(!fmt_ctx){
+        return false;
+    }
+    bool was_prefetching = isPrefetching();
+    stopPrefetch();
+
+    int ret = -1;
+    int ref = referenceStreamIndex();
+    const KeyframeIndex::Entry* kf = nullptr;
+    if(ref >= 0){
+        AVStream* st = fmt_ctx->streams[ref];
+        kf = keyframe_index_.lookup(ref,av_rescale_q(timestamp,AV_TIME_BASE_Q,st->time_base));
+    }
+    if(kf){
+        ret = av_seek_frame(fmt_ctx,ref,kf->pts,AVSEEK_FLAG_BACKWARD);
+        if(ret < 0 && kf->pos >= 0 && !(fmt_ctx->iformat->flags & AVFMT_NO_BYTE_SEEK)){
+            ret = av_seek_frame(fmt_ctx,ref,kf->pos,AVSEEK_FLAG_BYTE);
+        }
+    }
+    if(ret < 0){
+        ret = avformat_seek_file(fmt_ctx,-1,INT64_MIN,timestamp,timestamp,0);
+    }
+    if(ret < 0){
+        fprintf(stderr,"Could not seek to %" PRId64 "\n",timestamp);
+    }
+
+    if(was_prefetching){
+        startPrefetch();
+    }
+    return ret >= 0;
+}
+
+int Demuxer::readRange(int64_t start,int64_t end,const std::function<bool(AVPacket*)>& on_packet){
+    if(!seekTo(start)){
+        return -1;
+    }
+    int ref = referenceStreamIndex();
+    int count = 0;
+    AVPacket* pkt = av_packet_alloc();
+    if(!pkt){
+        return AVERROR(ENOMEM);
+    }
+    while(readPacket(pkt) >= 0){
+        if(pkt->stream_index == ref || ref < 0){
+            int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+            if(ts != AV_NOPTS_VALUE &&
+               av_rescale_q(ts,fmt_ctx->streams[pkt->stream_index]->time_base,AV_TIME_BASE_Q) >= end){
+                av_packet_unref(pkt);
+                break;
+            }
+        }
+        count++;
+        bool keep_going = on_packet(pkt);
+        av_packet_unref(pkt);
+        if(!keep_going){
+            break;
+        }
+    }
+    av_packet_free(&pkt);
+    return count;
+}
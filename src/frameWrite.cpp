@@ -1,4 +1,5 @@
 #include "frameWrite.hpp"
+#include "SampleInterleave.hpp"
 #include <iostream>
 #include <cassert>
 
@@ -39,15 +40,13 @@ bool PCMFrameWriter::writeFrame(const AVFrame* frame) {
 }
 
 bool PCMFrameWriter::writePlanar(const AVFrame* frame) {
-    for (int i = 0; i < frame->nb_samples; ++i) {
-        for (int ch = 0; ch < channels_; ++ch) {
-            const uint8_t* ptr = frame->data[ch] + i * bytesPerSample_;
-            if (fwrite(ptr, 1, bytesPerSample_, outFile) != (size_t)bytesPerSample_) {
-                return false;
-            }
-        }
+    //先整帧交错到缓冲区，再一次写出
+    size_t totalBytes = (size_t)frame->nb_samples * channels_ * bytesPerSample_;
+    if (interleaved_.size() < totalBytes) {
+        interleaved_.resize(totalBytes);
     }
-    return true;
+    SampleInterleave::interleave(interleaved_.data(), frame->extended_data, channels_, frame->nb_samples, bytesPerSample_);
+    return fwrite(interleaved_.data(), 1, totalBytes, outFile) == totalBytes;
 }
 
 bool PCMFrameWriter::writePacked(const AVFrame* frame) {
@@ -93,7 +92,6 @@ YUVFrameWriter::YUVFrameWriter(const std::string& filename)
     : filename_(filename),frameindex(0) {}
 
 YUVFrameWriter::~YUVFrameWriter() {
-    av_free(video_dst_data[0]);
     close();
 }
 
@@ -114,24 +112,40 @@ bool YUVFrameWriter::writeFrame(const AVFrame* frame) {
         width = frame->width;
         height = frame->height;
         pix_fmt = static_cast<AVPixelFormat>(frame->format);
-        int ret = av_image_alloc(video_dst_data, video_dst_linesize, width, height, pix_fmt, 1);
-        if (ret < 0) {
-            std::cerr << "Could not allocate raw video buffer\n";
+        ptrdiff_t linesizes[4];
+        size_t sizes[4];
+        if (av_image_fill_linesizes(plane_width, pix_fmt, width) < 0) {
+            std::cerr << "Unsupported raw video format\n";
+            return false;
+        }
+        for (int i = 0; i < 4; i++) {
+            linesizes[i] = plane_width[i];
+        }
+        if (av_image_fill_plane_sizes(sizes, pix_fmt, height, linesizes) < 0) {
+            std::cerr << "Unsupported raw video format\n";
             return false;
         }
-        video_dst_bufsize = ret;
+        for (int i = 0; i < 4; i++) {
+            plane_height[i] = plane_width[i] ? (int)(sizes[i] / plane_width[i]) : 0;
+        }
+        video_dst_bufsize = av_image_get_buffer_size(pix_fmt, width, height, 1);
     }
     if (frame->width != width || frame->height != height || frame->format != pix_fmt) {
     std::cerr << "Frame resolution or pixel format changed. Aborting.\n";
     return false;
     }
 
-    av_image_copy(video_dst_data, video_dst_linesize,
-                    (const uint8_t **)frame->data, frame->linesize,
-                   pix_fmt, width, height);
- 
-    /* write to rawvideo file */
-    fwrite(video_dst_data[0], 1, video_dst_bufsize, outFile);
+    /* write to rawvideo file，行宽无填充时整平面一次写出 */
+    for (int i = 0; i < 4 && plane_width[i] > 0; i++) {
+        const uint8_t* src = frame->data[i];
+        if (frame->linesize[i] == plane_width[i]) {
+            fwrite(src, 1, (size_t)plane_width[i] * plane_height[i], outFile);
+            continue;
+        }
+        for (int y = 0; y < plane_height[i]; y++) {
+            fwrite(src + (ptrdiff_t)y * frame->linesize[i], 1, plane_width[i], outFile);
+        }
+    }
     return true;
 }
 